@@ -0,0 +1,312 @@
+// Micro-benchmark of HTTP message head parsing.
+// Compares the regex based parser HttpMessage used before (copied below as it was), HttpMessage on top of
+// HttpParser and HttpParser alone with every HttpScanner kernel the CPU supports, and prints the parse
+// throughput of each in GB/s.
+// Then compares rewriting the Connection header (as HttpRewriteLayer does) by parsing, changing and building the
+// message again against splicing the change into the parsed head with HttpHeadEditor.
+//
+// Usage: tls-proxy-bench [ seconds per case, default 1 ]
+
+#include "http/HttpHeadEditor.h"
+#include "http/HttpMessage.h"
+#include "http/HttpMessageBuilder.h"
+#include "http/HttpParser.h"
+#include "http/HttpScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+static const string REQUEST = "GET /search?q=tls+proxy&source=hp&ei=abcdef HTTP/1.1\r\n"
+                              "Host: www.example.com\r\n"
+                              "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+                              "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,*/*;q=0.8\r\n"
+                              "Accept-Language: en-US,en;q=0.5\r\n"
+                              "Accept-Encoding: gzip, deflate, br\r\n"
+                              "Referer: https://www.example.com/\r\n"
+                              "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=en\r\n"
+                              "Connection: keep-alive\r\n"
+                              "Upgrade-Insecure-Requests: 1\r\n"
+                              "Sec-Fetch-Dest: document\r\n"
+                              "Sec-Fetch-Mode: navigate\r\n"
+                              "Sec-Fetch-Site: same-origin\r\n"
+                              "\r\n";
+
+static const string RESPONSE = "HTTP/1.1 200 OK\r\n"
+                               "Date: Mon, 02 Oct 2023 10:00:00 GMT\r\n"
+                               "Content-Type: text/html; charset=UTF-8\r\n"
+                               "Content-Length: 1256\r\n"
+                               "Cache-Control: private, max-age=0\r\n"
+                               "Expires: -1\r\n"
+                               "Server: gws\r\n"
+                               "X-XSS-Protection: 0\r\n"
+                               "X-Frame-Options: SAMEORIGIN\r\n"
+                               "Set-Cookie: id=0123456789abcdef; expires=Tue, 01-Oct-2024 10:00:00 GMT; path=/\r\n"
+                               "Alt-Svc: h3=\":443\"; ma=2592000,h3-29=\":443\"; ma=2592000\r\n"
+                               "\r\n";
+
+// A response with the large cookie and Content-Security-Policy headers common on real sites
+static string LargeResponse() {
+    string res = "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: 50213\r\n";
+
+    for (int i = 0; i < 8; i++) {
+        res += "Set-Cookie: c" + to_string(i) + "=" + string(400, 'a' + i) + "; Path=/; Secure; HttpOnly\r\n";
+    }
+
+    res += "Content-Security-Policy: default-src 'self'";
+
+    for (int i = 0; i < 60; i++) {
+        res += " https://cdn" + to_string(i) + ".example.com";
+    }
+
+    res += "; script-src 'self' 'nonce-" + string(32, 'n') + "'; object-src 'none'\r\n\r\n";
+    return res;
+}
+
+namespace legacy {
+
+// The regex based parsing of HttpMessage::ParseMessage as it was before HttpParser
+struct Message {
+    bool isRequest = false;
+    string method, path, version, status, host, data;
+    uint32_t port = 443;
+    unordered_map<string, string> headers;
+};
+
+static string Ltrim(const string& s) {
+    static regex re = regex(R"(^\s+)");
+    return regex_replace(s, re, string(""));
+}
+
+static string Rtrim(const string& s) {
+    static regex re = regex(R"(\s+$)");
+    return regex_replace(s, re, string(""));
+}
+
+static string Trim(const string& s) { return Ltrim(Rtrim(s)); }
+
+static string ToLower(const string& s) {
+    string lower;
+    lower.resize(s.size());
+    transform(s.begin(), s.end(), lower.begin(), ::tolower);
+    return lower;
+}
+
+static void ParseStartLine(Message& msg, const string& s) {
+    vector<string> parts;
+    string item;
+    stringstream ss(s);
+
+    while (getline(ss, item, ' ')) {
+        if (item.length() > 0) {
+            parts.emplace_back(item);
+        }
+    }
+
+    if (parts[0].find("HTTP") == 0) {
+        static const vector<string> groups{"NONE", R"(1\d\d)", R"(2\d\d)", R"(3\d\d)", R"(4\d\d)", R"(5\d\d)"};
+        smatch res;
+
+        msg.isRequest = false;
+        msg.version = parts[0];
+
+        // the status group was found by compiling and searching every pattern
+        for (const auto& group : groups) {
+            regex_search(parts[1], res, regex(group));
+        }
+
+        ss.str("");
+        ss.clear();
+
+        for (size_t i = 1; i < parts.size(); i++) {
+            ss << parts[i] << " ";
+        }
+
+        msg.status = Trim(ss.str());
+    } else {
+        msg.isRequest = true;
+        msg.method = parts[0];
+        msg.path = parts[1];
+        msg.version = parts[2];
+    }
+}
+
+static void AddNewHeader(Message& msg, const string& s) {
+    size_t delimLocation = s.find_first_of(":");
+    string key = ToLower(Trim(string(s, 0, delimLocation)));
+    string value = Trim(string(s, delimLocation + 1, s.size() - delimLocation - 1));
+
+    msg.headers.emplace(key, value);
+
+    if (key == "host") {
+        string host = value, port = "443";
+        delimLocation = value.find(":");
+        if (delimLocation != string::npos) {
+            host = string(value, 0, delimLocation);
+            port = string(value, delimLocation + 1, value.size() - delimLocation - 1);
+        }
+
+        msg.host = host;
+        msg.port = stoi(port);
+    }
+}
+
+static bool Parse(Message& msg, const string& message) {
+    bool isStartLine = true, parsingDone = false;
+    string data = message;
+    static regex newLine(R"(.*\r\n)");
+    smatch res;
+
+    while (!parsingDone && regex_search(data, res, newLine)) {
+        string line = Trim(res.str());
+
+        if (line.empty()) {
+            if (isStartLine) {
+                return false;
+            }
+
+            parsingDone = true;
+        } else if (isStartLine) {
+            ParseStartLine(msg, line);
+            isStartLine = false;
+        } else {
+            AddNewHeader(msg, line);
+        }
+
+        data = res.suffix();
+    }
+
+    msg.data = parsingDone ? data : "";
+    return true;
+}
+}; // namespace legacy
+
+// Run parse over message for about seconds and return the throughput in GB/s
+static double Measure(const string& message, double seconds, const function<size_t(const string&)>& parse) {
+    using clock = chrono::steady_clock;
+    size_t iterations = 0, sink = 0;
+    auto start = clock::now();
+    chrono::duration<double> elapsed(0);
+
+    do {
+        for (size_t i = 0; i < 64; i++) {
+            sink += parse(message);
+        }
+
+        iterations += 64;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < seconds);
+
+    // keep the compiler from dropping the parsing
+    if (sink == 0) {
+        cerr << "Nothing was parsed" << endl;
+    }
+
+    return (static_cast<double>(message.size()) * iterations) / elapsed.count() / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+    vector<pair<string, function<size_t(const string&)>>> parsers{
+        {"legacy regex", [](const string& message) {
+             legacy::Message msg;
+             return legacy::Parse(msg, message) ? msg.headers.size() : 0;
+         }},
+        {"HttpMessage", [](const string& message) { return HttpMessage(message).Headers().Size(); }},
+    };
+
+    for (auto kernel : {HttpScanner::Kernel::SCALAR, HttpScanner::Kernel::SSE42, HttpScanner::Kernel::AVX2}) {
+        parsers.emplace_back(string("HttpParser ") + HttpScanner::KernelName(kernel), [kernel](const string& message) {
+            // a connection keeps its parser, so its headers storage is reused
+            static HttpParser parser;
+
+            parser.Reset();
+            return parser.Parse(message) == HttpParser::Status::DONE ? parser.HeadersCount() : 0;
+        });
+    }
+
+    const vector<pair<string, string>> messages{
+        {"request", REQUEST}, {"response", RESPONSE}, {"large response", LargeResponse()}};
+
+    HttpScanner::Kernel best = HttpScanner::GetKernel();
+    cout << fixed << setprecision(3);
+
+    for (const auto& message : messages) {
+        double base = 0;
+
+        cout << message.first << " (" << message.second.size() << " bytes)" << endl;
+
+        for (size_t i = 0; i < parsers.size(); i++) {
+            // the HttpParser cases are the last ones, one for each kernel
+            size_t kernel = i + 3 - parsers.size();
+
+            if (i + 3 >= parsers.size() && !HttpScanner::SetKernel(static_cast<HttpScanner::Kernel>(kernel))) {
+                continue;
+            }
+
+            double rate = Measure(message.second, seconds, parsers[i].second);
+            base = base == 0 ? rate : base;
+
+            cout << "  " << setw(18) << left << parsers[i].first << right << ": " << setw(8) << rate << " GB/s (x"
+                 << setprecision(1) << rate / base << setprecision(3) << ")" << endl;
+
+            HttpScanner::SetKernel(best);
+        }
+    }
+
+    const vector<pair<string, function<size_t(const string&)>>> rewriters{
+        {"rebuild", [](const string& message) {
+             HttpMessageBuilder builder(message);
+
+             builder.Headers().Set("Connection", "keep-alive");
+             return builder.Build().ToString().size();
+         }},
+        {"HttpHeadEditor", [](const string& message) {
+             static HttpParser parser;
+             static const string* source = nullptr;
+             static SharedBuffer buffer;
+
+             // the proxy reads the message into a shared buffer, it is not copied per run
+             if (source != &message) {
+                 source = &message;
+                 buffer = make_shared<const string>(message);
+             }
+
+             parser.Reset();
+             parser.Parse(*buffer);
+
+             HttpMessage http(buffer, buffer->size(), parser);
+             HttpHeadEditor edits(http);
+
+             edits.Set("Connection", "keep-alive");
+             return edits.ToChain().Size();
+         }},
+    };
+
+    for (const auto& message : messages) {
+        double base = 0;
+
+        cout << "rewrite " << message.first << endl;
+
+        for (const auto& rewriter : rewriters) {
+            double rate = Measure(message.second, seconds, rewriter.second);
+            base = base == 0 ? rate : base;
+
+            cout << "  " << setw(18) << left << rewriter.first << right << ": " << setw(8) << rate << " GB/s (x"
+                 << setprecision(1) << rate / base << setprecision(3) << ")" << endl;
+        }
+    }
+
+    return 0;
+}
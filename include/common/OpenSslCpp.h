@@ -8,6 +8,7 @@ using X509 = struct x509_st;
 using BIO = struct bio_st;
 using SSL = struct ssl_st;
 using SSL_CTX = struct ssl_ctx_st;
+using SSL_SESSION = struct ssl_session_st;
 };
 
 // A Utility class to wrap OpenSSL pointer types
@@ -64,6 +65,7 @@ using X509_PTR = X509*;
 using BIO_PTR = BIO*;
 using SSL_PTR = SSL*;
 using SSL_CTX_PTR = SSL_CTX*;
+using SSL_SESSION_PTR = SSL_SESSION*;
 
 // aliasing OpenSSL free() function
 using EVP_PKEY_deleter_t = void (*)(EVP_PKEY_PTR);
@@ -71,6 +73,7 @@ using X509_deleter_t = void (*)(X509_PTR);
 using BIO_deleter_t = int (*)(BIO_PTR);
 using SSL_deleter_t = void (*)(SSL_PTR);
 using SSL_CTX_deleter_t = void (*)(SSL_CTX_PTR);
+using SSL_SESSION_deleter_t = void (*)(SSL_SESSION_PTR);
 
 // aliasing OpenSSL utility class with the corret free() functions
 using EVP_PKEY_OPTR = OpensslWrapper<EVP_PKEY, EVP_PKEY_deleter_t>;
@@ -78,6 +81,7 @@ using X509_OPTR = OpensslWrapper<X509, X509_deleter_t>;
 using BIO_OPTR = OpensslWrapper<BIO, BIO_deleter_t>;
 using SSL_OPTR = OpensslWrapper<SSL, SSL_deleter_t>;
 using SSL_CTX_OPTR = OpensslWrapper<SSL_CTX, SSL_CTX_deleter_t>;
+using SSL_SESSION_OPTR = OpensslWrapper<SSL_SESSION, SSL_SESSION_deleter_t>;
 
 // macros to ease the creation of new OpenSSL objects
 #define DEF_VARIABLE(var_type, name, init_value) var_type##_OPTR name{(init_value), var_type##_free};
@@ -86,3 +90,4 @@ using SSL_CTX_OPTR = OpensslWrapper<SSL_CTX, SSL_CTX_deleter_t>;
 #define DEF_BIO(var_name, var_value) DEF_VARIABLE(BIO, var_name, (var_value))
 #define DEF_SSL(var_name, var_value) DEF_VARIABLE(SSL, var_name, (var_value))
 #define DEF_SSL_CTX(var_name, var_value) DEF_VARIABLE(SSL_CTX, var_name, (var_value))
+#define DEF_SSL_SESSION(var_name, var_value) DEF_VARIABLE(SSL_SESSION, var_name, (var_value))
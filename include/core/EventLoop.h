@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Interface for objects which want to be notified about events on file descriptors
+// registered in an EventLoop.
+class EventHandler {
+  public:
+    virtual ~EventHandler() = default;
+
+    // Called from the loop thread with the epoll events that fired for fd
+    virtual void OnEvent(int32_t fd, uint32_t events) = 0;
+};
+
+// A single threaded, edge-triggered epoll reactor.
+// Every EventLoop is run by exactly one thread and all handlers, timers and posted tasks
+// registered in it are called from that thread, so connection state never needs locking.
+// Since notifications are edge-triggered, handlers must keep reading/writing until the
+// operation would block before returning to the loop.
+class EventLoop {
+  public:
+    using task_t = std::function<void()>;
+    using clock_t = std::chrono::steady_clock;
+
+    EventLoop();
+    ~EventLoop();
+
+    // Run the loop in the calling thread until Stop() is called
+    void Run();
+
+    // Stop the loop, safe to call from any thread
+    void Stop();
+
+    // Register fd for read, write and hangup notifications.
+    // The handler is kept alive by the loop until the fd is removed.
+    bool Add(int32_t fd, std::shared_ptr<EventHandler> handler);
+
+    // Unregister fd, must be called before fd is closed
+    void Remove(int32_t fd);
+
+    // Call task from the loop thread once delay has passed, returns an id that can be used to cancel it
+    uint64_t AddTimer(std::chrono::milliseconds delay, task_t task);
+
+    // Cancel a timer which did not fire yet
+    void CancelTimer(uint64_t timerId);
+
+    // Queue task to be called from the loop thread, safe to call from any thread
+    void Post(task_t task);
+
+    bool InLoopThread() const { return std::this_thread::get_id() == _threadId; }
+
+  private:
+    struct Watch {
+        std::shared_ptr<EventHandler> handler;
+        uint32_t generation;
+    };
+
+    // Return the time until the closest timer expires in milliseconds, or -1 if there are no timers
+    int32_t NextTimeout() const;
+    void RunExpiredTimers();
+    void RunPostedTasks();
+
+    int32_t _epoll;
+    int32_t _wakeup;
+    std::atomic<bool> _running;
+    std::thread::id _threadId;
+
+    std::vector<Watch> _watches;
+    uint32_t _generation;
+
+    std::map<std::pair<clock_t::time_point, uint64_t>, task_t> _timers;
+    std::unordered_map<uint64_t, clock_t::time_point> _timerDeadlines;
+    uint64_t _nextTimerId;
+
+    std::mutex _postLock;
+    std::vector<task_t> _posted;
+};
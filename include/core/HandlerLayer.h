@@ -4,9 +4,25 @@
 #include "utils/Logger.h"
 #include <memory>
 
+// What a layer needs to see of a HTTP message.
+// The body is passed only to the layers which need it, so the cost of a headers only layer does not depend on the
+// size of the body, and the body is relayed without passing through the chain if no layer needs it
+enum class LayerCapability : uint8_t {
+    HEADERS_ONLY,  // gets HTTP_HEAD messages only
+    BODY_OBSERVER, // gets the HTTP_BODY messages as well, and returns them unchanged
+    BODY_MUTATOR   // may change the body, a layer which changes its size is responsible for the framing headers
+};
+
 // This is the base class for all middleware layers.
 // It's called a Handler Layer because each middleware layer should handle the data
 // passing through it.
+// Requests travel from the first layer in the chain to the last one, responses travel back
+// from the last layer to the first one. The ProxyConnection owning the chain sends whatever the
+// last layer returns to the other side of the connection.
+// Messages are moved through the chain, a layer which does not handle the type of a message replaces it
+// with an error message.
+// The built-in layers are composed at compile time by a Pipeline, a dynamic chain is meant for plugins which are
+// added to it at runtime.
 class HandlerLayer {
   public:
     HandlerLayer(std::unique_ptr<HandlerLayer> next) : _next(std::move(next)) {}
@@ -16,22 +32,93 @@ class HandlerLayer {
     virtual std::string GetName() const = 0;
     inline void SetNext(std::unique_ptr<HandlerLayer> next);
 
+    virtual LayerCapability GetCapability() const { return LayerCapability::HEADERS_ONLY; }
+
+    // True if a layer of the chain starting at layer has to get the body of the messages
+    static inline bool NeedsBody(const HandlerLayer* layer);
+
+    // Return the first layer of the chain starting at layer which handles msg, nullptr if there is none
+    static inline HandlerLayer* FirstFor(HandlerLayer* layer, const Message& msg);
+
+    // Should be implamented by each middleware class.
+    // This function will be called each time a request is pushed down to this layer, the layer
+    // should pass the (possibly modified) request to the next layer using PushToNext.
+    virtual Message ProcessRequest(Message msg) = 0;
+
     // Should be implamented by each middleware class.
-    // This function will be called each time a layer will push data down to the next
-    // middleware layer.
-    virtual std::shared_ptr<Message> ProcessMessage(std::shared_ptr<Message> msg) = 0;
-    inline std::shared_ptr<Message> PushToNext(std::shared_ptr<Message> msg);
+    // This function will be called each time a response is pulled up through this layer, the layer
+    // should first let the next layers handle the response using PullFromNext.
+    virtual Message ProcessResponse(Message msg) = 0;
+
+    inline Message PushToNext(Message msg);
+    inline Message PullFromNext(Message msg);
 
   private:
     std::unique_ptr<HandlerLayer> _next;
 };
 
-std::shared_ptr<Message> HandlerLayer::PushToNext(std::shared_ptr<Message> msg) {
-    if (_next != nullptr) {
-        return _next->ProcessMessage(msg);
+bool HandlerLayer::NeedsBody(const HandlerLayer* layer) {
+    for (; layer != nullptr; layer = layer->_next.get()) {
+        if (layer->GetCapability() != LayerCapability::HEADERS_ONLY) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HandlerLayer* HandlerLayer::FirstFor(HandlerLayer* layer, const Message& msg) {
+    // headers only layers are skipped by the body
+    while (layer != nullptr && msg.Type() == MessageTypes::HTTP_BODY &&
+           layer->GetCapability() == LayerCapability::HEADERS_ONLY) {
+        layer = layer->_next.get();
+    }
+
+    return layer;
+}
+
+Message HandlerLayer::PushToNext(Message msg) {
+    HandlerLayer* next = FirstFor(_next.get(), msg);
+
+    if (next != nullptr) {
+        return next->ProcessRequest(std::move(msg));
+    } else {
+        return msg;
+    }
+}
+
+Message HandlerLayer::PullFromNext(Message msg) {
+    HandlerLayer* next = FirstFor(_next.get(), msg);
+
+    if (next != nullptr) {
+        return next->ProcessResponse(std::move(msg));
     } else {
-        return std::make_shared<ErrorMessage>("Next layer is null");
+        return msg;
     }
 }
 
 void HandlerLayer::SetNext(std::unique_ptr<HandlerLayer> next) { _next = std::move(next); }
+
+// Wraps a layer written for a Pipeline so it can be a part of a dynamic chain
+template <typename Layer>
+class DynamicLayer : public HandlerLayer {
+  public:
+    template <typename... Args>
+    explicit DynamicLayer(std::unique_ptr<HandlerLayer> next, Args&&... args)
+        : HandlerLayer(std::move(next)), _layer(std::forward<Args>(args)...) {}
+    ~DynamicLayer() override = default;
+
+    std::string GetName() const override { return _layer.GetName(); }
+    LayerCapability GetCapability() const override { return Layer::CAPABILITY; }
+
+    Message ProcessRequest(Message msg) override {
+        return _layer.ProcessRequest(std::move(msg), [this](Message next) { return PushToNext(std::move(next)); });
+    }
+
+    Message ProcessResponse(Message msg) override {
+        return _layer.ProcessResponse(std::move(msg), [this](Message next) { return PullFromNext(std::move(next)); });
+    }
+
+  private:
+    Layer _layer;
+};
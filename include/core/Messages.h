@@ -1,23 +1,62 @@
 #pragma once
 
-#include <atomic>
+#include "http/HttpHeadEditor.h"
+#include "http/HttpMessage.h"
+#include "utils/BufferChain.h"
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 
-enum class MessageTypes : int8_t { ERROR, OK, EMPTY, STRING_DATA, NUM_MESSAGE_TYPES };
+enum class MessageTypes : int8_t { ERROR, OK, EMPTY, STRING_DATA, HTTP_HEAD, HTTP_BODY, NUM_MESSAGE_TYPES };
+
+// The parsed head of an HTTP_HEAD message.
+// Layers read the parsed message and change its headers through Edits, the changes are applied when the head
+// leaves the chain
+struct HttpHead {
+    HttpHead(SharedBuffer buffer, size_t size, HttpParser& parser)
+        : Http(std::move(buffer), size, parser), Edits(Http) {}
+
+    // Edits refers to Http
+    HttpHead(const HttpHead&) = delete;
+    HttpHead& operator=(const HttpHead&) = delete;
+
+    HttpMessage Http;
+    HttpHeadEditor Edits;
+};
 
 // Class used to pass messages between layers, Messages can contain data of different types,
 // error messages, etc.
+// A message is a value which is moved from layer to layer, its data is a chain of slices of the buffers it was
+// read into so it is never copied, and the layers tell its kind by Type().
+// Ids are given by the connection which created the message and are unique within it, the body of a HTTP message
+// is passed in HTTP_BODY messages (a part of the body as it was read, chunked framing included) with the id of
+// its head.
 class Message {
   public:
-    Message(MessageTypes msgType) : _id(NextId()), _type(msgType) {}
+    Message(MessageTypes msgType, uint32_t id) : Data(), Head(), ErrorString(), _id(id), _type(msgType) {}
+    ~Message() = default;
+
+    Message(Message&&) = default;
+    Message& operator=(Message&&) = default;
+    Message(const Message&) = delete;
+    Message& operator=(const Message&) = delete;
+
+    // An error message replacing the message with the id
+    static Message Error(uint32_t id, std::string error) {
+        Message msg(MessageTypes::ERROR, id);
+
+        msg.ErrorString = std::move(error);
+        return msg;
+    }
+
+    inline MessageTypes Type() const { return _type; }
+    inline uint32_t Id() const { return _id; }
+
     std::string ToString() const {
         return "<Id=" + std::to_string(_id) + ", type=" + MessageTypesToString(_type) + ">";
     }
 
-    virtual ~Message() = default;
-
     static std::string MessageTypesToString(MessageTypes msgType) {
         switch (msgType) {
         case MessageTypes::ERROR:
@@ -28,38 +67,20 @@ class Message {
             return "Empty";
         case MessageTypes::STRING_DATA:
             return "StringData";
+        case MessageTypes::HTTP_HEAD:
+            return "HttpHead";
+        case MessageTypes::HTTP_BODY:
+            return "HttpBody";
         default:
             return "Unkown";
         }
     }
 
-  protected:
-    int32_t _id;
-    MessageTypes _type;
+    BufferChain Data;               // STRING_DATA, HTTP_HEAD (the bytes of the head) and HTTP_BODY
+    std::unique_ptr<HttpHead> Head; // HTTP_HEAD
+    std::string ErrorString;        // ERROR
 
   private:
-    static int32_t NextId() {
-        static int32_t id;
-        return ++id;
-    }
-};
-
-struct ErrorMessage : public Message {
-    ErrorMessage(std::string error) : Message(MessageTypes::ERROR), ErrorString(std::move(error)) {}
-
-    std::string ErrorString;
-};
-
-struct OkMessage : public Message {
-    OkMessage() : Message(MessageTypes::OK) {}
-};
-
-struct EmptyMessage : public Message {
-    EmptyMessage() : Message(MessageTypes::EMPTY) {}
+    uint32_t _id;
+    MessageTypes _type;
 };
-
-struct StringDataMessage : public Message {
-    StringDataMessage(std::string data) : Message(MessageTypes::STRING_DATA), Data(std::move(data)) {}
-
-    std::string Data;
-};
\ No newline at end of file
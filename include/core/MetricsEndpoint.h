@@ -0,0 +1,28 @@
+#pragma once
+
+#include "core/EventLoop.h"
+#include <functional>
+#include <ostream>
+#include <string>
+
+// A minimal HTTP endpoint which serves GET /metrics as Prometheus text, meant for a loopback admin port.
+// It runs in an event loop of the server like the connections, every request gets the current metrics rendered
+// by render and its connection is closed once the response was written.
+class MetricsEndpoint : public EventHandler {
+  public:
+    using render_t = std::function<void(std::ostream&)>;
+
+    MetricsEndpoint(EventLoop& loop, render_t render) : _loop(loop), _render(std::move(render)) {}
+
+    // Called when the listening socket has pending connections
+    void OnEvent(int32_t fd, uint32_t events) override;
+
+  private:
+    class Connection;
+
+    // The response to the request head in request
+    std::string Respond(const std::string& request);
+
+    EventLoop& _loop;
+    render_t _render;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/HandlerLayer.h"
+#include "core/Messages.h"
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// True if one of the capabilities needs the body
+constexpr bool AnyNeedsBody() { return false; }
+
+template <typename... Capabilities>
+constexpr bool AnyNeedsBody(LayerCapability capability, Capabilities... others) {
+    return capability != LayerCapability::HEADERS_ONLY || AnyNeedsBody(others...);
+}
+
+// A middleware chain composed at compile time.
+// The layers are members of the pipeline (a single object, usually a member of its connection) and each layer
+// gets the rest of the chain as a callable, so the calls between the layers are direct and can be inlined.
+// A layer of a pipeline is any class with:
+//   static constexpr LayerCapability CAPABILITY;
+//   std::string GetName() const;
+//   template <typename Next> Message ProcessRequest(Message msg, Next&& next);
+//   template <typename Next> Message ProcessResponse(Message msg, Next&& next);
+// where next(msg) passes the message to the rest of the chain, like PushToNext and PullFromNext of a HandlerLayer.
+// HTTP_BODY messages skip the headers only layers, which is decided by the compiler.
+// A dynamic chain of HandlerLayers (plugins) may be added after the last layer.
+template <typename... Layers>
+class Pipeline {
+  public:
+    Pipeline() : _layers(), _plugins(nullptr), _needsBody(NEEDS_BODY) {}
+    ~Pipeline() = default;
+
+    // Add a dynamic chain after the layers of the pipeline
+    inline void SetNext(std::unique_ptr<HandlerLayer> plugins) {
+        _plugins = std::move(plugins);
+        _needsBody = NEEDS_BODY || HandlerLayer::NeedsBody(_plugins.get());
+    }
+
+    // True if a layer has to get the body of the messages, otherwise it should not be passed to the pipeline
+    inline bool NeedsBody() const { return _needsBody; }
+
+    // Pass a request from the first layer to the last one
+    inline Message ProcessRequest(Message msg) { return Request(std::move(msg), Index<0>()); }
+
+    // Pass a response from the last layer to the first one
+    inline Message ProcessResponse(Message msg) { return Response(std::move(msg), Index<0>()); }
+
+  private:
+    template <size_t I>
+    using Index = std::integral_constant<size_t, I>;
+
+    template <size_t I>
+    using Layer = typename std::tuple_element<I, std::tuple<Layers...>>::type;
+
+    static constexpr bool NEEDS_BODY = AnyNeedsBody(Layers::CAPABILITY...);
+
+    // True if the layer at I handles msg
+    template <size_t I>
+    static inline bool Handles(const Message& msg) {
+        return Layer<I>::CAPABILITY != LayerCapability::HEADERS_ONLY || msg.Type() != MessageTypes::HTTP_BODY;
+    }
+
+    template <size_t I>
+    inline Message Request(Message msg, Index<I>) {
+        if (!Handles<I>(msg)) {
+            return Request(std::move(msg), Index<I + 1>());
+        }
+
+        return std::get<I>(_layers).ProcessRequest(
+            std::move(msg), [this](Message next) { return Request(std::move(next), Index<I + 1>()); });
+    }
+
+    inline Message Request(Message msg, Index<sizeof...(Layers)>) {
+        HandlerLayer* plugin = HandlerLayer::FirstFor(_plugins.get(), msg);
+        return plugin == nullptr ? std::move(msg) : plugin->ProcessRequest(std::move(msg));
+    }
+
+    template <size_t I>
+    inline Message Response(Message msg, Index<I>) {
+        if (!Handles<I>(msg)) {
+            return Response(std::move(msg), Index<I + 1>());
+        }
+
+        return std::get<I>(_layers).ProcessResponse(
+            std::move(msg), [this](Message next) { return Response(std::move(next), Index<I + 1>()); });
+    }
+
+    inline Message Response(Message msg, Index<sizeof...(Layers)>) {
+        HandlerLayer* plugin = HandlerLayer::FirstFor(_plugins.get(), msg);
+        return plugin == nullptr ? std::move(msg) : plugin->ProcessResponse(std::move(msg));
+    }
+
+    std::tuple<Layers...> _layers;
+    std::unique_ptr<HandlerLayer> _plugins;
+    bool _needsBody;
+};
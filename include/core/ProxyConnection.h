@@ -0,0 +1,242 @@
+#pragma once
+
+#include "common/OpenSslCpp.h"
+#include "core/EventLoop.h"
+#include "core/Pipeline.h"
+#include "core/SslHandlerLayer.h"
+#include "http/HttpFramer.h"
+#include "middleware/HttpRewriteLayer.h"
+#include "middleware/LogHttpLayer.h"
+#include "utils/AccessLog.h"
+#include "utils/BufferChain.h"
+#include "utils/Resolver.h"
+#include "utils/SingleFlight.h"
+#include <chrono>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+
+class BackendSslLayer;
+class FrontendSslLayer;
+class SslClient;
+class SslServer;
+class UpstreamConnector;
+class UpstreamPool;
+
+// This class handles a single client connection from accept to close.
+// The connection is a state machine driven by the EventLoop that accepted it, every step is
+// non-blocking and returns to the loop as soon as a socket would block, so a single loop thread
+// can serve any number of connections.
+//
+// The states follow the flow of a proxied connection:
+//   PEEK_CONNECT -> [FETCH_CERTIFICATE] -> WRITE_CONNECT_REPLY (HTTP CONNECT)
+//   CLIENT_HANDSHAKE -> [FETCH_CERTIFICATE] -> CLIENT_HANDSHAKE (SNI)
+//   READ_REQUEST_HEAD -> [WAIT_UPSTREAM] -> RELAY -> READ_REQUEST_HEAD (keep-alive) or CLOSED
+//
+// Where FETCH_CERTIFICATE is skipped if the certificate is cached, otherwise only the first connection of a
+// server name fetches it (WAIT_UPSTREAM) and keeps the upstream connection for its request, the other
+// connections wait for it in WAIT_CERTIFICATE. The fetcher is bounded by the upstream connect timeout (which
+// covers the name resolution) and wakes the waiters once it is done: they fail with it if the fetch failed and look
+// the certificate up again if the fetcher closed for another reason (one of them fetches it then). The waiters
+// have a timeout of their own.
+//
+// The upstream connection has states of its own (UpstreamState: RESOLVE -> CONNECT -> HANDSHAKE -> READY) as
+// it is set up alongside the client side: once the certificate is known it starts connecting while the client
+// handshakes and sends its request, and the request waits in WAIT_UPSTREAM only if it is not ready yet.
+// It is checked out of the loop's UpstreamPool when possible, skipping the upstream connect and handshake, and
+// is returned to it once a keep-alive response was read. Otherwise the addresses of the server are raced by an
+// UpstreamConnector.
+//
+// In RELAY both directions are streamed at once, bytes are written to the other side as soon as they are
+// read. The middleware only sees the head (start line and headers) of every message, the body is relayed
+// as is. The end of every message is found by an HttpFramer, so the exchange completes the moment the last
+// byte of the response was relayed and pipelined requests are served one after the other.
+class ProxyConnection : public EventHandler, public std::enable_shared_from_this<ProxyConnection> {
+  public:
+    enum class State : uint8_t {
+        PEEK_CONNECT,
+        WAIT_UPSTREAM,
+        WRITE_CONNECT_REPLY,
+        CLIENT_HANDSHAKE,
+        WAIT_CERTIFICATE,
+        READ_REQUEST_HEAD,
+        RELAY,
+        CLOSED
+    };
+
+    enum class UpstreamState : uint8_t {
+        NONE,
+        RESOLVE,   // waiting for the resolver
+        CONNECT,   // waiting for the UpstreamConnector
+        HANDSHAKE, // the TLS handshake with the server
+        READY
+    };
+
+    ProxyConnection(SslServer& server, EventLoop& loop, UpstreamPool& upstreamPool, SSL_OPTR ssl);
+    ~ProxyConnection() override;
+
+    // Register the connection in its event loop and start processing it
+    void Start();
+
+    // Called by the event loop whenever one of the connection sockets is ready
+    void OnEvent(int32_t fd, uint32_t events) override;
+
+    // Called by the ClientHello callback, returns SSL_CLIENT_HELLO_RETRY to pause the handshake until
+    // the certificate for serverName is ready
+    int32_t OnClientHello(const std::string& serverName);
+
+  private:
+    // The middleware of every connection, the layers in processing order
+    using Middleware = Pipeline<LogHttpLayer, HttpRewriteLayer>;
+
+    // One direction of the relay.
+    // A pipe holds at most one buffer of data, once it is full no more data is read from the source until
+    // the buffer was written to the destination, so a slow reader slows down the writer instead of
+    // growing the buffer.
+    // The data is written from slices of the buffer it was read into (and of the lines the middleware changed),
+    // it is not copied on its way. The bytes of the buffer are not changed while it is shared with other slices.
+    struct Pipe {
+        enum class Stage : uint8_t {
+            HEAD, // reading the message head, it is passed through the middleware once complete
+            BODY, // relaying the rest of the message
+            DONE  // the message is complete, only the buffered data is written
+        };
+
+        Stage stage = Stage::HEAD;
+        std::shared_ptr<std::string> buffer = std::make_shared<std::string>(); // data read from the source
+        BufferChain out;        // data to write to the destination
+        size_t offset = 0;      // bytes of out already written
+        HttpParser parser;      // finds the end of the message head
+        HttpFramer framer;      // finds the end of the message
+        uint32_t messageId = 0; // id of the message head, its body is passed through the middleware with it
+        std::string pending;    // data which was read past the end of the message
+    };
+
+    // Run the state machine until it can not make progress without waiting for an event
+    void Drive();
+
+    // Each step returns true if the state changed and the machine should keep going
+    bool HandleHttpConnect();
+    bool WriteConnectReply();
+    bool ClientHandshake();
+    bool UpstreamHandshake();
+    bool ReadRequestHead();
+    bool Relay();
+
+    // Use the cached certificate of the server name, wait for the connection which already fetches it or
+    // fetch it from the server
+    void AcquireCertificate();
+    void OnCertificateReady(SingleFlight::Outcome outcome);
+    void CompleteCertificateFetch(SingleFlight::Outcome outcome);
+
+    // Continue the flow which was paused for the certificate
+    void ContinueWithCertificate();
+
+    // Start the upstream connection once the certificate is known, ahead of the request
+    void PreconnectUpstream();
+
+    // Send the request once the upstream connection is ready, waiting for it in WAIT_UPSTREAM if needed
+    void AwaitUpstream();
+
+    // Check out an idle upstream connection, or resolve the server name (from the resolver cache or on the
+    // thread pool) and start connecting to it
+    void StartUpstream();
+    void OnResolved(const addresses_t& addresses);
+    void OnUpstreamConnected(int32_t socket);
+
+    // An idle upstream connection may have been closed by the server just before it was used, send the
+    // request again on another connection
+    bool RetryUpstream();
+
+    // The upstream connection failed, the connection is closed if it waits for it. A connection made ahead of
+    // the request is only dropped (ResetUpstream), the request connects again
+    void AbortUpstream();
+    void ResetUpstream();
+
+    // Wait for the next request of the client
+    void StartRequest();
+    void StartRelay();
+
+    // Pass the head of the message in pipe through the middleware once it was read completely,
+    // returns false if the head is not complete yet
+    bool CompleteHead(Pipe& pipe, bool isRequest);
+
+    // Pass the data read into pipe from offset to its framer (and to the middleware if a layer needs the body) and
+    // queue it to be written
+    void ConsumeBody(Pipe& pipe, size_t offset);
+
+    // Empty the buffer of pipe before more data is read into it, once all its data was written. A buffer which
+    // is still shared (with the request replay) is left as is and a new one is used instead
+    void ReuseBuffer(Pipe& pipe);
+
+    // Move data between the sockets, progress is set if any data was moved
+    void RelayRequest(bool& progress);
+    void RelayResponse(bool& progress);
+    bool ReadResponseHead(bool& progress);
+
+    // Release the upstream connection once the response was relayed and wait for the next request,
+    // complete is false if the response was ended by the server closing the connection
+    void FinishExchange(bool complete);
+
+    // A persistent client connection is closed once no request started for the client idle timeout,
+    // an exchange is aborted once no data was relayed for the relay timeout
+    void RestartReadTimer();
+    void OnReadIdle();
+
+    // Pass the head of the message in pipe through the middleware chain and queue it with the changes the layers
+    // made to it. Returns false if one of the layers failed to handle it
+    bool RunMiddleware(Pipe& pipe, bool isRequest, size_t headSize);
+
+    // Pass size bytes of the body in pipe at offset through the middleware chain and queue the result.
+    // Returns false if one of the layers failed to handle it
+    bool RunBodyMiddleware(Pipe& pipe, size_t offset, size_t size);
+
+    // The record of the exchange (its sizes and the time of every stage) is filled as it goes, once it ended it is
+    // added to the Metrics and written to the access log. complete is false if the exchange was aborted
+    void RecordHead(const HttpMessage& head, const HttpParser& parser, bool isRequest, size_t headSize);
+    void EndExchange(bool complete);
+
+    void Close(bool shutdown);
+
+    uint32_t _id;
+    SslServer& _server;
+    EventLoop& _loop;
+    UpstreamPool& _upstreamPool;
+    State _state;
+
+    std::unique_ptr<FrontendSslLayer> _frontend;
+    std::unique_ptr<BackendSslLayer> _backend;
+    UpstreamState _upstreamState;
+    bool _isBackendReused;
+    bool _isBackendIdle; // the upstream connection was ready before the request, the server may have closed it
+    std::shared_ptr<SslClient> _client;
+    std::shared_ptr<UpstreamConnector> _connector; // races the addresses of the server in UpstreamState::CONNECT
+    Middleware _middleware;
+    uint32_t _lastMessageId;
+
+    std::string _serverName;
+    int32_t _serverPort;
+    bool _isHttpConnect;
+    std::string _certificateName; // the server name or the wildcard it shares, see SslServer::CertificateName
+    X509_OPTR _certificate;
+    bool _isCertificateFetcher;
+    uint64_t _timer;
+    uint64_t _upstreamTimer; // the resolve and connect timeout, it runs alongside the timers of the client side
+
+    std::string _connectReply;
+    size_t _writeOffset;
+
+    Pipe _requestPipe;
+    Pipe _responsePipe;
+    BufferChain _requestReplay;
+    bool _isRequestReplayable;
+    bool _isServerClosed;
+
+    uint32_t _exchanges;
+    AccessRecord _access; // the record of the current exchange, its startTime is 0 if no exchange started
+    std::string _accessPath;
+    std::chrono::steady_clock::time_point _exchangeStart;
+    std::chrono::steady_clock::time_point _stageStart;       // start of the client stage the connection is in
+    std::chrono::steady_clock::time_point _certificateStart; // set while the certificate is fetched
+    std::chrono::steady_clock::time_point _upstreamStart;
+};
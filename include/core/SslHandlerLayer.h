@@ -4,34 +4,50 @@
 #include <string>
 
 #include "common/OpenSslCpp.h"
+#include "utils/BufferChain.h"
+
+// Result of a non-blocking SSL operation
+enum class SslStatus : uint8_t {
+    OK,               // The operation completed
+    WANT_IO,          // The socket would block, retry once the event loop reports it is ready
+    WANT_CERTIFICATE, // The handshake was paused by the ClientHello callback until a certificate is ready
+    CLOSED,           // The peer closed the connection
+    ERROR             // Fatal error, the connection should be closed
+};
 
 // This is a base class for all ssl middleware layers.
-// It will ease the use of OpenSSL read/write/connect/accept/close APIs, will handle errors
-// and socket connection type (blocking/non-blocking)
+// It will ease the use of OpenSSL read/write/connect/accept/close APIs and will handle errors.
+// The socket is switched to non-blocking mode once on creation, all operations return SslStatus::WANT_IO
+// instead of blocking and should be retried when the event loop reports the socket is ready.
 class SslHandlerLayer {
   public:
-    SslHandlerLayer(SSL_OPTR ssl) : _ssl(std::move(ssl)), _socket(SSL_get_fd(_ssl)), _connectionWasClosed(false) {}
+    SslHandlerLayer(SSL_OPTR ssl);
     virtual ~SslHandlerLayer() { DoClose(true); };
 
-    // Read from an SSL Socket and return the data as string
-    std::string DoSslRead();
+    // Read the data currently available on the SSL Socket and append it to data, until data reaches maxSize.
+    // Returns SslStatus::OK if data is full, the rest of the data should be read once there is room for it
+    SslStatus DoSslRead(std::string& data, size_t maxSize);
 
-    // Write data to an SSL Socket and return number of bytes written
-    int32_t DoSslWrite(const std::string& data);
+    // Write data to an SSL Socket starting from offset, offset is advanced by the number of bytes written
+    SslStatus DoSslWrite(const BufferChain& data, size_t& offset);
 
     // Perform connect/accept depending on the SSL Socket type
     // Client will perform connect, Server will perform accept
-    bool DoSslConnectAccept();
+    SslStatus DoSslConnectAccept();
 
     // Close SSL Socket
     void DoClose(bool shutdown);
 
+    SSL_PTR GetSsl() { return _ssl.Get(); }
+    int32_t GetSocket() const { return _socket; }
+
   protected:
     SSL_OPTR _ssl;
     int32_t _socket;
     bool _connectionWasClosed;
+    bool _sslFailed;
 
   private:
-    bool HandleSslError(int32_t ret);
-    void ToggleBlockingMode();
-};
\ No newline at end of file
+    SslStatus HandleSslError(int32_t ret);
+    void SetNonBlockingMode();
+};
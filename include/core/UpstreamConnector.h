@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/EventLoop.h"
+#include "utils/Resolver.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SslClient;
+
+// Connect to a server over the first of its addresses which answers, racing them (Happy Eyeballs, RFC 8305).
+// The address which won the last race of the origin is tried first, then the families alternate starting with
+// IPv6. A new attempt starts every ATTEMPT_DELAY, or as soon as all the running ones failed, until one of them
+// connects and the others are closed.
+// The connector runs in the loop of its connection, its sockets are registered in it while they connect.
+class UpstreamConnector : public EventHandler, public std::enable_shared_from_this<UpstreamConnector> {
+  public:
+    // Called from the loop with the connected socket, which is then owned by the callee, or -1 if all the
+    // addresses failed
+    using callback_t = std::function<void(int32_t socket)>;
+
+    static constexpr auto ATTEMPT_DELAY = std::chrono::milliseconds(250);
+
+    UpstreamConnector(EventLoop& loop, std::shared_ptr<SslClient> client, const addresses_t& addresses,
+                      callback_t callback);
+    ~UpstreamConnector() override { Cancel(); }
+
+    // Start the first attempt
+    void Start();
+
+    // Close all the running attempts, the callback is not called
+    void Cancel();
+
+    // Called by the event loop once an attempt connected or failed
+    void OnEvent(int32_t fd, uint32_t events) override;
+
+  private:
+    // Start the next address, returns false if there are no more addresses
+    bool StartNext();
+
+    // The origin failed, or the socket won the race
+    void Finish(int32_t socket, const struct sockaddr_storage* address);
+
+    EventLoop& _loop;
+    std::shared_ptr<SslClient> _client;
+    std::string _origin;
+    addresses_t _addresses; // in the order they are tried, with the port of the server
+    size_t _next;
+    std::vector<std::pair<int32_t, size_t>> _attempts; // the sockets which are connecting and their addresses
+    uint64_t _timer;
+    callback_t _callback;
+};
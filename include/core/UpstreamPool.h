@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/EventLoop.h"
+#include "middleware/BackendSslLayer.h"
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Upstream connection pool limits
+struct UpstreamPoolConfig {
+    size_t maxIdle;                        // idle connections kept by the pool, 0 disables the pool
+    size_t maxIdlePerHost;                 // idle connections kept for a single (host, port)
+    std::chrono::milliseconds idleTimeout; // idle connections are closed after this time
+};
+
+// A pool of idle, already handshaken backend connections per (host, port).
+// Every event loop has its own pool, a connection is checked out by the request path instead of connecting
+// to the server and is returned once its response was fully read, so its sockets never leave the loop thread
+// and the pool needs no locking.
+// While a connection is idle the pool watches its socket, a connection the server closed (or wrote to) is
+// dropped right away.
+class UpstreamPool : public EventHandler, public std::enable_shared_from_this<UpstreamPool> {
+  public:
+    UpstreamPool(EventLoop& loop, const UpstreamPoolConfig& config);
+    ~UpstreamPool() override = default;
+
+    // Check out an idle connection to host:port, returns nullptr if there is none.
+    // The connection is no longer registered in the loop, the caller should register it
+    std::unique_ptr<BackendSslLayer> Acquire(const std::string& host, int32_t port);
+
+    // Return a connection whose response was fully read, the connection must not be registered in the loop
+    void Release(const std::string& host, int32_t port, std::unique_ptr<BackendSslLayer> backend);
+
+    // Called by the event loop when an idle connection is readable or closed
+    void OnEvent(int32_t fd, uint32_t events) override;
+
+  private:
+    struct IdleConnection {
+        std::unique_ptr<BackendSslLayer> backend;
+        uint64_t timer;
+    };
+
+    using idle_list_t = std::list<IdleConnection>;
+
+    // Remove the idle connection of fd from the pool and close it
+    void Drop(int32_t fd, bool shutdown);
+
+    EventLoop& _loop;
+    UpstreamPoolConfig _config;
+
+    // idle connections per host:port, the most recently released connection is the last one
+    std::unordered_map<std::string, idle_list_t> _idle;
+    std::unordered_map<int32_t, std::pair<std::string, idle_list_t::iterator>> _sockets;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "http/HttpParser.h"
+#include <cstdint>
+#include <string>
+
+// A class used to find where a HTTP/1.x message ends.
+// The framer is started with the head of a message (start line and headers) and then consumes the body
+// bytes as they arrive, it reports the message as complete the moment its last byte was consumed,
+// so the reader never has to wait for more data to find out the message ended.
+// The body length is found according to RFC 7230 section 3.3.3:
+//   * Responses to HEAD requests, 1xx, 204 and 304 responses have no body.
+//   * A chunked Transfer-Encoding ends with the last chunk and the trailer.
+//   * Content-Length gives the length of the body.
+//   * Otherwise a request has no body and a response ends when the server closes the connection.
+class HttpFramer {
+  public:
+    enum class BodyType : uint8_t {
+        NONE,    // the message has no body
+        LENGTH,  // the body length is given by Content-Length
+        CHUNKED, // chunked transfer coding
+        CLOSE    // the body ends when the connection is closed
+    };
+
+    HttpFramer();
+    ~HttpFramer() = default;
+
+    // Start framing a new message from its parsed head, returns false if the message framing is invalid.
+    // isHeadRequest tells if a response answers a HEAD request
+    bool Start(const HttpParser& head, bool isHeadRequest);
+
+    // Relay everything until the connection is closed, used once the connection was upgraded
+    void StartTunnel();
+
+    // Consume body bytes of the message, returns the number of bytes which belong to the message.
+    // Bytes past the returned count belong to the next message
+    size_t Consume(const char* data, size_t size);
+
+    inline BodyType GetBodyType() const { return _bodyType; }
+    inline bool IsComplete() const { return _state == State::DONE; }
+    inline bool HasError() const { return _state == State::ERROR; }
+
+    // True if the connection is kept open after the message
+    inline bool IsKeepAlive() const { return _isKeepAlive; }
+
+    // True for a HEAD request
+    inline bool IsHeadRequest() const { return _isHeadRequest; }
+
+    // True for an interim (1xx) response, the final response follows it on the same connection
+    inline bool IsInterim() const { return _isInterim; }
+
+    // True for a 101 Switching Protocols response, the connection is no longer HTTP after it
+    inline bool IsUpgrade() const { return _isUpgrade; }
+
+    // True if the message has both Transfer-Encoding and Content-Length, it is framed by the first and the
+    // Content-Length must be removed before the message is forwarded (RFC 7230 section 3.3.3), a peer which
+    // trusted it would find another end of the message (request smuggling)
+    inline bool IsLengthOverridden() const { return _isLengthOverridden; }
+
+  private:
+    enum class State : uint8_t { BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, CHUNK_END_LF, TRAILER, DONE, ERROR };
+
+    // Parse the start line and the headers which affect the framing
+    bool ParseHead(const HttpParser& head, int32_t& status, bool& isChunked, bool& hasContentLength);
+
+    // Handle a complete chunk size or trailer line
+    void OnChunkSizeLine();
+    void OnTrailerLine();
+
+    BodyType _bodyType;
+    State _state;
+    uint64_t _remaining; // bytes left of the body or of the current chunk
+    std::string _line;   // partial chunk size or trailer line
+
+    bool _isKeepAlive;
+    bool _isHeadRequest;
+    bool _isInterim;
+    bool _isUpgrade;
+    bool _isLengthOverridden;
+};
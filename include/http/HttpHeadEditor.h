@@ -0,0 +1,65 @@
+#pragma once
+
+#include "http/HttpMessage.h"
+#include "utils/BufferChain.h"
+#include "utils/StringView.h"
+#include <string>
+#include <vector>
+
+// A list of changes to the headers of a parsed HTTP message.
+// The message is not parsed or serialized again, the edited message is the original one with the changed header
+// lines spliced in: Segments() returns the pieces of the result in order, unchanged lines are views into the
+// original message. The message must outlive the editor and the segments are valid until the next change.
+class HttpHeadEditor {
+  public:
+    explicit HttpHeadEditor(const HttpMessage& message);
+    ~HttpHeadEditor() = default;
+
+    // Set the value of the first header called name and remove the others, or add it if there is none
+    void Set(StringView name, StringView value);
+
+    // Remove all the headers called name
+    void Remove(StringView name);
+
+    // Add a header after all the others
+    void Append(StringView name, StringView value);
+
+    // True if the message was not changed
+    inline bool Empty() const { return _edits.empty() && _appended.empty(); }
+
+    // The pieces of the edited message, including the data after its head
+    std::vector<StringView> Segments() const;
+
+    // Append the edited message to out, all the segments are copied with a single allocation
+    void WriteTo(std::string& out) const;
+
+    // The edited message as slices, unchanged lines are slices of the message buffer and only the changed lines
+    // are copied (to a single new buffer)
+    BufferChain ToChain() const;
+
+  private:
+    // A change to an original header line, the line is removed if its replacement is empty
+    struct Edit {
+        size_t index;
+        std::string line;
+    };
+
+    // A header which was not in the original message
+    struct Appended {
+        size_t nameSize;
+        std::string line; // name: value CRLF
+    };
+
+    static std::string MakeLine(StringView name, StringView value);
+
+    // Return the edit of the original header at index, nullptr if the line is not changed
+    Edit* FindEdit(size_t index);
+    const Edit* FindEdit(size_t index) const;
+
+    // Replace (or remove, if line is empty) the original header at index
+    void EditLine(size_t index, std::string line);
+
+    const HttpMessage& _message;
+    std::vector<Edit> _edits;
+    std::vector<Appended> _appended;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "utils/StringView.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Headers the proxy looks at, a name is matched to its id once so looking it up later is an integer compare
+enum class HttpHeaderId : uint8_t {
+    UNKNOWN,
+    HOST,
+    CONNECTION,
+    CONTENT_LENGTH,
+    TRANSFER_ENCODING,
+    CONTENT_TYPE,
+    CONTENT_ENCODING,
+    KEEP_ALIVE,
+    PROXY_CONNECTION,
+    UPGRADE,
+    EXPECT,
+    TE,
+    TRAILER,
+    ACCEPT,
+    ACCEPT_ENCODING,
+    ACCEPT_LANGUAGE,
+    USER_AGENT,
+    COOKIE,
+    SET_COOKIE,
+    CACHE_CONTROL,
+    DATE,
+    SERVER,
+    LOCATION,
+    REFERER,
+    AUTHORIZATION,
+    PROXY_AUTHORIZATION,
+    CONTENT_SECURITY_POLICY,
+    VIA,
+    X_FORWARDED_FOR,
+    COUNT
+};
+
+// The headers of a HTTP message, kept in the order they appear in it with the original case of their names.
+// Repeated headers (such as Set-Cookie) are all kept.
+// The names and values of all the headers are stored one after the other in a single buffer and every header
+// is an id and offsets into it, so adding headers does not allocate per header.
+class HttpHeaders {
+  public:
+    struct Header {
+        HttpHeaderId id;
+        StringView name;
+        StringView value;
+    };
+
+    class Iterator {
+      public:
+        Iterator(const HttpHeaders& headers, size_t index) : _headers(headers), _index(index) {}
+
+        inline Header operator*() const { return _headers.At(_index); }
+        inline Iterator& operator++() {
+            _index++;
+            return *this;
+        }
+        inline bool operator!=(const Iterator& other) const { return _index != other._index; }
+
+      private:
+        const HttpHeaders& _headers;
+        size_t _index;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HttpHeaders() = default;
+    ~HttpHeaders() = default;
+
+    // Return the id of a header name (case insensitive), UNKNOWN if it is not one of the well known headers
+    static HttpHeaderId IdOf(StringView name);
+
+    // Return the name of a well known header as it is usually written
+    static StringView NameOf(HttpHeaderId id);
+
+    // Make room for count headers with names and values of bytes in total
+    void Reserve(size_t count, size_t bytes);
+
+    inline size_t Size() const { return _entries.size(); }
+    inline bool Empty() const { return _entries.empty(); }
+    Header At(size_t index) const;
+
+    inline Iterator begin() const { return Iterator(*this, 0); }
+    inline Iterator end() const { return Iterator(*this, _entries.size()); }
+
+    // Return the index of the first header with the id or the name (case insensitive), or npos
+    size_t Find(HttpHeaderId id, size_t start = 0) const;
+    size_t Find(StringView name, size_t start = 0) const;
+
+    inline bool Has(HttpHeaderId id) const { return Find(id) != npos; }
+    inline bool Has(StringView name) const { return Find(name) != npos; }
+
+    // Return the value of the first header with the id or the name, or an empty view if there is none
+    StringView Get(HttpHeaderId id) const;
+    StringView Get(StringView name) const;
+
+    // Add a header after the existing ones, returns its id
+    HttpHeaderId Add(StringView name, StringView value);
+
+    // Set the value of the first header called name and remove the others, or add it if there is none
+    void Set(StringView name, StringView value);
+
+    // Remove all the headers called name, returns the number of removed headers
+    size_t Remove(StringView name);
+
+    void Clear();
+
+  private:
+    struct Entry {
+        HttpHeaderId id;
+        uint32_t nameOffset;
+        uint32_t nameSize;
+        uint32_t valueOffset;
+        uint32_t valueSize;
+    };
+
+    // Copy s to the end of the buffer and return its offset
+    uint32_t Store(StringView s);
+
+    size_t Find(HttpHeaderId id, StringView name, size_t start) const;
+
+    std::string _buffer;
+    std::vector<Entry> _entries;
+};
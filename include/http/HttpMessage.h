@@ -1,9 +1,13 @@
 #pragma once
 
+#include "http/HttpHeaders.h"
+#include "utils/BufferChain.h"
+#include "utils/StringView.h"
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+class HttpParser;
+
 // A class used to parse and represent a HTTP message.
 class HttpMessage {
     // Forward decleration
@@ -16,23 +20,31 @@ class HttpMessage {
 
     enum class HttpStatusCodeGroup : uint8_t { NONE, S1XX, S2XX, S3XX, S4XX, S5XX };
 
-    enum class HttpParsingParts : uint8_t { START_LINE, HEADERS, DATA };
-
     explicit HttpMessage(const std::string& message);
 
+    // Create the message from the first size bytes of buffer, which parser already parsed (possibly in another
+    // copy of the bytes) so they are not parsed again. The message shares the buffer instead of copying it
+    HttpMessage(SharedBuffer buffer, size_t size, HttpParser& parser);
+
     // Getters
-    inline const std::string& OriginalMessage() const { return _originalMessage; }
+    inline StringView OriginalMessage() const { return StringView(_buffer->data(), _size); }
+    inline const SharedBuffer& Buffer() const { return _buffer; }
     inline bool IsRequest() const { return _isRequest; }
     inline HttpMethod Method() const { return _method; }
     inline const std::string& Host() const { return _host; }
     inline const std::string& Path() const { return _path; }
     inline uint32_t Port() const { return _port; }
-    inline const std::unordered_map<std::string, std::string>& Headers() const { return _headers; }
+    inline const HttpHeaders& Headers() const { return _headers; }
     inline HttpVersion Version() const { return _version; }
     inline HttpStatusCodeGroup StatusCodeGroup() const { return _statusCodeGroup; }
     inline const std::string& Status() const { return _status; }
     inline const std::string& Data() const { return _data; }
 
+    // The lines of the message head in OriginalMessage(), including their line ends.
+    // Header lines are in the order of Headers()
+    inline StringView StartLine() const { return View(_startLine); }
+    inline StringView HeaderLine(size_t index) const { return View(_headerLines[index]); }
+
     // Utility functions to convers enums to string representation
     const std::string& HttpVersionToString(HttpVersion version) const;
     const std::string& HttpStatusCodeGroupToString(HttpStatusCodeGroup status) const;
@@ -41,25 +53,40 @@ class HttpMessage {
     std::string ToString() const;
 
   private:
-    bool ParseMessage();
+    // Location of a line in the original message
+    struct Span {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    inline StringView View(Span span) const { return StringView(_buffer->data() + span.offset, span.size); }
+    inline Span ToSpan(StringView s) const {
+        return Span{static_cast<uint32_t>(s.data() - _buffer->data()), static_cast<uint32_t>(s.size())};
+    }
+
+    void Init(HttpParser& parser);
+    bool ParseMessage(HttpParser& parser);
     bool Validate() const;
-    bool ParseStartLine(const std::string& s);
-    bool AddNewHeader(const std::string& s);
-    bool AddData(const std::string& s);
+    void ParseStartLine(const HttpParser& parser);
+    // Returns false if the header is invalid, e.g. a host with an invalid port
+    bool AddNewHeader(StringView name, StringView value);
 
     std::string CommonHttpMessageToString() const;
     std::string RequestToString() const;
     std::string ResponseToString() const;
 
-    std::string _originalMessage;
+    SharedBuffer _buffer;
+    size_t _size;
     bool _isRequest;
     HttpMethod _method;
     std::string _host;
     std::string _path;
     uint32_t _port;
-    std::unordered_map<std::string, std::string> _headers;
+    HttpHeaders _headers;
     HttpVersion _version;
     HttpStatusCodeGroup _statusCodeGroup;
     std::string _status;
     std::string _data;
+    Span _startLine;
+    std::vector<Span> _headerLines;
 };
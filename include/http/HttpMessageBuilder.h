@@ -2,8 +2,6 @@
 
 #include "http/HttpMessage.h"
 #include <string>
-#include <unordered_map>
-#include <vector>
 
 // A class used to build a HTTP message.
 class HttpMessageBuilder {
@@ -19,7 +17,7 @@ class HttpMessageBuilder {
     inline std::string& Host() { return _msg._host; }
     inline std::string& Path() { return _msg._path; }
     inline uint32_t& Port() { return _msg._port; }
-    inline std::unordered_map<std::string, std::string>& Headers() { return _msg._headers; }
+    inline HttpHeaders& Headers() { return _msg._headers; }
     inline HttpMessage::HttpVersion& Version() { return _msg._version; }
     inline HttpMessage::HttpStatusCodeGroup& StatusCodeGroup() { return _msg._statusCodeGroup; }
     inline std::string& Status() { return _msg._status; }
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "utils/StringView.h"
+#include <cstdint>
+#include <vector>
+
+// A resumable parser of HTTP/1.x message heads (start line and headers).
+// Line ends and header names are found with HttpScanner, which also rejects control characters in the head.
+// The parser never copies the message, it only records where every field is in the receive buffer and
+// returns StringView slices of it. Parse can be called again whenever more data was received, it continues
+// from where the previous call stopped, so a head which arrives in many reads is scanned only once.
+// The buffer may grow (and move) between calls but the bytes already passed must not change, and the views
+// returned by the parser are valid until the buffer changes. Once the head was parsed, calling Parse with a copy
+// of it only moves the views to the copy.
+class HttpParser {
+  public:
+    enum class Status : uint8_t {
+        INCOMPLETE, // the head did not end yet, call Parse again with more data
+        DONE,       // the whole head was parsed
+        ERROR       // the data is not an HTTP message head
+    };
+
+    struct Header {
+        StringView name;
+        StringView value;
+        StringView line; // the whole header line including its line end
+    };
+
+    HttpParser();
+    ~HttpParser() = default;
+
+    // Forget the parsed message and get ready for a new one
+    void Reset();
+
+    // Parse data, which starts with the data passed in the previous calls since the last Reset()
+    Status Parse(const char* data, size_t size);
+    Status Parse(StringView data) { return Parse(data.data(), data.size()); }
+
+    inline Status GetStatus() const { return _status; }
+    inline bool IsRequest() const { return _isRequest; }
+
+    // Size of the head including the empty line which ends it, the body starts right after it
+    inline size_t HeadSize() const { return _headSize; }
+
+    // The start line including its line end
+    inline StringView StartLine() const { return View(_startLine); }
+
+    // Start line fields, method and path are empty for responses, status code and reason for requests
+    inline StringView Method() const { return View(_method); }
+    inline StringView Path() const { return View(_path); }
+    inline StringView Version() const { return View(_version); }
+    inline StringView StatusCode() const { return View(_statusCode); }
+    inline StringView Reason() const { return View(_reason); }
+
+    // The status code of a response as a number, the parser rejects a status code which is not 3 digits
+    inline uint16_t StatusCodeValue() const { return _statusCodeValue; }
+
+    // Headers in the order they appear in the message, names keep their original case
+    inline size_t HeadersCount() const { return _headers.size(); }
+    inline Header GetHeader(size_t i) const {
+        return Header{View(_headers[i].name), View(_headers[i].value), View(_headers[i].line)};
+    }
+
+    // Return the value of the first header called name (case insensitive), or an empty view
+    StringView FindHeader(StringView name) const;
+
+  private:
+    // Location of a field in the buffer, offsets are kept instead of pointers since the buffer may move
+    struct Span {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct HeaderSpan {
+        Span name;
+        Span value;
+        Span line;
+    };
+
+    inline StringView View(Span span) const { return StringView(_data + span.offset, span.size); }
+    inline Span ToSpan(StringView s) const {
+        return Span{static_cast<uint32_t>(s.data() - _data), static_cast<uint32_t>(s.size())};
+    }
+
+    // lineSize is the size of the line including its line end
+    bool ParseStartLine(StringView line, size_t lineSize);
+    bool ParseHeaderLine(StringView line, size_t lineSize);
+
+    const char* _data;
+    Status _status;
+    size_t _lineStart;  // offset of the first line which was not parsed yet
+    size_t _scanOffset; // the line was already scanned up to here
+    size_t _headSize;
+    bool _isStartLine;
+    bool _isRequest;
+
+    Span _startLine;
+    Span _method;
+    Span _path;
+    Span _version;
+    Span _statusCode;
+    Span _reason;
+    uint16_t _statusCodeValue;
+    std::vector<HeaderSpan> _headers;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Character scanning used by the HTTP parser to find delimiters in a message head 16 or 32 bytes at a time.
+// The kernel is chosen once by the CPU features (AVX2, then SSE4.2), every kernel returns the same results
+// as the scalar one.
+class HttpScanner {
+  public:
+    enum class Kernel : uint8_t { SCALAR, SSE42, AVX2 };
+
+    // Return the offset of the first byte which can not be a part of a header field value (a control character
+    // other than HT, or DEL), or size if there is none. CR and LF are control characters, so this finds
+    // the end of a line as well as invalid characters in it
+    static size_t FindFieldEnd(const char* data, size_t size);
+
+    // Return the offset of the first byte which is not a token character (RFC 7230 section 3.2.6), or size if
+    // there is none
+    static size_t FindTokenEnd(const char* data, size_t size);
+
+    static inline Kernel GetKernel() { return _kernel; }
+    static const char* KernelName(Kernel kernel);
+
+    // Use another kernel, used to compare them. Returns false if the CPU does not support it
+    static bool SetKernel(Kernel kernel);
+
+  private:
+    static Kernel _kernel;
+};
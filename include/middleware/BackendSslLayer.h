@@ -1,31 +1,23 @@
 #pragma once
 
 #include "common/OpenSslCpp.h"
-#include "core/HandlerLayer.h"
 #include "core/SslHandlerLayer.h"
 
 // A Middleware layer to handle the backend ssl connection.
 // This layer will be resposible to connect to the real HTTPS server,
 // to fetch the server certificate and send the data from the client to the
 // HTTPS server.
-class BackendSslLayer : public HandlerLayer, public SslHandlerLayer {
+// The layer is driven by the ProxyConnection which owns it.
+class BackendSslLayer : public SslHandlerLayer {
   public:
-    BackendSslLayer(std::unique_ptr<HandlerLayer> next, SSL_OPTR ssl)
-        : HandlerLayer(std::move(next)), SslHandlerLayer(std::move(ssl)) {
-        SSL_set_connect_state(_ssl);
-    }
-
-    explicit BackendSslLayer(SSL_OPTR ssl) : BackendSslLayer(nullptr, std::move(ssl)) {}
+    explicit BackendSslLayer(SSL_OPTR ssl) : SslHandlerLayer(std::move(ssl)) { SSL_set_connect_state(_ssl); }
     ~BackendSslLayer() override = default;
 
-    std::string GetName() const override { return "BackendSslLayer"; };
+    std::string GetName() const { return "BackendSslLayer"; };
 
-    // Will return the HTTPS server certificate
+    // Will return the HTTPS server certificate, the handshake must be completed
     X509_PTR GetCertificate();
 
     // Will connect to the HTTPS server
-    bool Connect();
-
-    // Implements the data processing function
-    std::shared_ptr<Message> ProcessMessage(std::shared_ptr<Message> msg) override;
-};
\ No newline at end of file
+    SslStatus Connect();
+};
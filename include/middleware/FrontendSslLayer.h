@@ -1,7 +1,6 @@
 #pragma once
 
 #include "common/OpenSslCpp.h"
-#include "core/HandlerLayer.h"
 #include "core/SslHandlerLayer.h"
 
 // A Middleware layer to handle the frontend ssl connection.
@@ -15,18 +14,11 @@
 //     When using this proxy in transparent mode (the client is not aware of it), it will send a request with
 //     SNI extension indicating the name of the server he wishes to connect to.
 // 3. When a request will arrive with no HTTP CONNECT an no SNI -> the connection will be dropped.
-class FrontendSslLayer : public HandlerLayer, public SslHandlerLayer {
+// The layer is driven by the ProxyConnection which owns it.
+class FrontendSslLayer : public SslHandlerLayer {
   public:
-    FrontendSslLayer(std::unique_ptr<HandlerLayer> next, SSL_OPTR ssl)
-        : HandlerLayer(std::move(next)), SslHandlerLayer(std::move(ssl)) {
-        SSL_set_accept_state(_ssl);
-    }
-
-    explicit FrontendSslLayer(SSL_OPTR ssl) : FrontendSslLayer(nullptr, std::move(ssl)) {}
+    explicit FrontendSslLayer(SSL_OPTR ssl) : SslHandlerLayer(std::move(ssl)) { SSL_set_accept_state(_ssl); }
     ~FrontendSslLayer() override = default;
 
-    std::string GetName() const override { return "FrontendSslLayer"; };
-
-    // Implements the data processing function
-    std::shared_ptr<Message> ProcessMessage(std::shared_ptr<Message> msg) override;
-};
\ No newline at end of file
+    std::string GetName() const { return "FrontendSslLayer"; };
+};
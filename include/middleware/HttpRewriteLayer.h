@@ -3,18 +3,43 @@
 #include "core/HandlerLayer.h"
 #include <iostream>
 
-// A Middleware layer used to convert http keep-alive sessions to
-// no-keep-alive sessions.
-// We use this layer as we want a simple proxy to support 1 REQUEST -> 1 RESPONSE
-class HttpRewriteLayer : public HandlerLayer {
+// A Middleware layer which lets the upstream connections persist, so they can be reused by the upstream pool.
+// A HTTP/1.0 request which does not ask to close or upgrade the connection asks the server to keep it alive.
+// Requests with a close or upgrade token in their Connection header, HTTP/1.1 requests (persistent unless they
+// say otherwise) and all the responses are relayed unchanged.
+// The layer is a part of the connection Pipeline, use DynamicLayer<HttpRewriteLayer> to add it to a dynamic chain.
+class HttpRewriteLayer {
   public:
-    HttpRewriteLayer(std::unique_ptr<HandlerLayer> next) : HandlerLayer(std::move(next)) {}
+    HttpRewriteLayer() = default;
+    ~HttpRewriteLayer() = default;
 
-    explicit HttpRewriteLayer() : HandlerLayer(nullptr) {}
-    ~HttpRewriteLayer() override = default;
+    static constexpr LayerCapability CAPABILITY = LayerCapability::HEADERS_ONLY;
 
-    std::string GetName() const override { return "HttpRewriteLayer"; };
+    std::string GetName() const { return "HttpRewriteLayer"; };
 
-    // Implements the data processing function
-    std::shared_ptr<Message> ProcessMessage(std::shared_ptr<Message> msg) override;
+    // Implements the data processing functions
+    template <typename Next>
+    Message ProcessRequest(Message msg, Next&& next);
+    template <typename Next>
+    Message ProcessResponse(Message msg, Next&& next);
+
+  private:
+    // Rewrite the request head in msg, a message which is not a HTTP head is replaced with an error
+    static Message Rewrite(Message msg);
 };
+
+template <typename Next>
+Message HttpRewriteLayer::ProcessRequest(Message msg, Next&& next) {
+    Message res = Rewrite(std::move(msg));
+
+    if (res.Type() == MessageTypes::ERROR) {
+        return res;
+    }
+
+    return next(std::move(res));
+}
+
+template <typename Next>
+Message HttpRewriteLayer::ProcessResponse(Message msg, Next&& next) {
+    return next(std::move(msg));
+}
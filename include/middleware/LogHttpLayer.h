@@ -5,22 +5,46 @@
 class HttpMessage;
 
 // A Middleware layer used to log HTTP messages.
-class LogHttpLayer : public HandlerLayer {
+// The layer is a part of the connection Pipeline, use DynamicLayer<LogHttpLayer> to add it to a dynamic chain.
+class LogHttpLayer {
   public:
-    LogHttpLayer(std::unique_ptr<HandlerLayer> next) : HandlerLayer(std::move(next)), _remoteHost("") {}
+    LogHttpLayer() : _remoteHost(""), _remotePort(0) {}
+    ~LogHttpLayer() = default;
 
-    explicit LogHttpLayer() : HandlerLayer(nullptr) {}
-    ~LogHttpLayer() override = default;
+    static constexpr LayerCapability CAPABILITY = LayerCapability::HEADERS_ONLY;
 
-    std::string GetName() const override { return "LogHttpLayer"; };
+    std::string GetName() const { return "LogHttpLayer"; };
 
-    // Implements the data processing function
-    std::shared_ptr<Message> ProcessMessage(std::shared_ptr<Message> msg) override;
+    // Implements the data processing functions
+    template <typename Next>
+    Message ProcessRequest(Message msg, Next&& next);
+    template <typename Next>
+    Message ProcessResponse(Message msg, Next&& next);
 
     // Will log the HTTP message
     void LogHttpMessage(const HttpMessage& httpMessage);
 
   private:
+    // Log the head in msg, a message which is not a HTTP head is replaced with an error
+    Message LogRequest(Message msg);
+    Message LogResponse(Message msg);
+
     std::string _remoteHost;
     uint32_t _remotePort;
 };
+
+template <typename Next>
+Message LogHttpLayer::ProcessRequest(Message msg, Next&& next) {
+    Message res = LogRequest(std::move(msg));
+
+    if (res.Type() == MessageTypes::ERROR) {
+        return res;
+    }
+
+    return next(std::move(res));
+}
+
+template <typename Next>
+Message LogHttpLayer::ProcessResponse(Message msg, Next&& next) {
+    return LogResponse(next(std::move(msg)));
+}
@@ -3,8 +3,9 @@
 #include "common/OpenSslCpp.h"
 #include "ssl/SslConfig.h"
 #include "ssl/SslHandler.h"
-#include "utils/ThreadPool.h"
+#include "utils/SessionCache.h"
 #include <memory>
+#include <netinet/in.h>
 
 // Client related configuration
 struct SslClientConfig : public SslConfig {
@@ -23,18 +24,29 @@ class SslClient : public SslHandler {
     SslClient(std::unique_ptr<SslClientConfig> config);
     virtual ~SslClient() = default;
 
-    // Create connection with the HTTPS server and return the BackendSslLayer that handles this connection
-    std::unique_ptr<BackendSslLayer> Connect();
+    // Create a non-blocking TCP socket and start connecting it to an address of the HTTPS server.
+    // Returns the socket or -1, the connect completes in the background (see UpstreamConnector)
+    int32_t CreateSocket(const struct sockaddr_storage& serverAddr);
+
+    // Return the BackendSslLayer that handles a connected socket, it takes the ownership of socket.
+    // The caller should complete the SSL handshake once the socket is ready.
+    std::unique_ptr<BackendSslLayer> Connect(int32_t socket);
+
+    const SslClientConfig& GetConfig() const { return *_config; }
+
+    // Counters of the sessions kept for resuming upstream connections
+    static SessionCacheStats GetSessionStats();
 
   protected:
     // Configure the OpenSSL CTX object
     bool ConfigureSslContext(SSL_CTX_PTR ctx, const SslConfig& config) override;
 
   private:
-    // Create a TCP socket
-    int32_t CreateSocket();
+    // The context of all the upstream connections, it is created (and configured) by the first client
+    SSL_CTX_PTR GetContext();
+
+    // Keep the new session of an upstream connection, to resume the next connection to the same origin
+    static int32_t NewSessionCb(SSL_PTR ssl, SSL_SESSION_PTR session);
 
     std::unique_ptr<SslClientConfig> _config;
-    SSL_CTX_OPTR _ctx;
-    int32_t _socket;
 };
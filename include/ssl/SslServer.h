@@ -1,10 +1,25 @@
 #pragma once
 
 #include "common/OpenSslCpp.h"
+#include "core/EventLoop.h"
+#include "core/UpstreamPool.h"
 #include "ssl/SslConfig.h"
 #include "ssl/SslHandler.h"
+#include "utils/AccessLog.h"
+#include "utils/CertificateAuthority.h"
+#include "utils/CertificateCache.h"
+#include "utils/DomainPatterns.h"
+#include "utils/PublicSuffixList.h"
+#include "utils/Resolver.h"
+#include "utils/SessionCache.h"
+#include "utils/SingleFlight.h"
+#include "utils/TicketKeys.h"
 #include "utils/ThreadPool.h"
+#include <csignal>
 #include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
 
 // Server related configuration
 struct SslServerConfig : public SslConfig {
@@ -12,45 +27,121 @@ struct SslServerConfig : public SslConfig {
     std::string listenIp;
     std::string caCertificateFile;
     std::string keyFile;
+    uint32_t numberOfWorkers;
+    size_t certificateCacheSize;
+    std::string certificatesDir; // optional second tier for the certificate cache, empty to disable
+    UpstreamPoolConfig upstreamPool;
+    std::chrono::milliseconds clientIdleTimeout; // persistent client connections are closed after this idle time
+    AccessLogConfig accessLog;
+    int32_t adminPort; // loopback port of the metrics endpoint, 0 to disable it
+    size_t sessionCacheSize;                // 0 disables the session cache, clients may still resume with tickets
+    std::chrono::seconds sessionTimeout;    // lifetime of a session (and of its tickets)
+    std::chrono::seconds ticketKeyRotation; // a new session ticket key is used after this time, 0 disables tickets
+    ResolverConfig resolver;
+    std::vector<std::string> mintDomains; // patterns of the hosts whose certificate is minted from their name only
+    std::vector<std::string> wildcardDomains; // patterns of the hosts which share a minted wildcard certificate
+    std::string publicSuffixFile;             // the public suffix list, read only if there are wildcard domains
 };
 
 // This class will handle income SSL connections.
-// Each SSL connection will be handled by a separate thread from start to end.
+// The server runs one event loop per worker thread, each loop has its own listening socket
+// (SO_REUSEPORT lets the kernel balance new connections between them) and drives all the
+// connections it accepted as non-blocking state machines.
 class SslServer : public SslHandler {
   public:
     SslServer(std::unique_ptr<SslServerConfig> config);
     virtual ~SslServer() = default;
 
-    // Start's the server, initialize related variables and start the main server loop
+    // Start's the server, initialize related variables and run the event loops.
+    // The calling thread runs the first loop and returns once the server is stopped.
     void Start();
 
-    // Stop the server main loop and clear the related variables
+    // Stop the server event loops and clear the related variables
     void Stop();
 
-    SslServerConfig GetConfig() const { return *_config; }
+    // Stop the server from its first event loop once one of signals is received, called before Start().
+    // The signals must be blocked in all the threads of the process.
+    void StopOnSignals(const sigset_t& signals) { _stopSignals = signals; }
+
+    const SslServerConfig& GetConfig() const { return *_config; }
+
+    // Thread pool used for blocking work which must not run on an event loop (e.g. name resolution)
+    ThreadPool& GetThreadPool() { return *_threadPool; }
+
+    // Look the certificate of serverName up in the in-memory cache and then in the cache directory
+    X509_OPTR LookupCertificate(const std::string& serverName);
+
+    // Generate the certificate of serverName on the fly from the certificate of the real server and store it
+    // in the in-memory cache and the cache directory
+    X509_OPTR GenerateCertificate(const std::string& serverName, X509_OPTR serverCertificate);
+
+    // Return true if the certificate of serverName is minted from the name, without connecting to the real server
+    bool ShouldMint(const std::string& serverName) const {
+        return _mintDomains.Matches(serverName) || _wildcardDomains.Matches(serverName);
+    }
+
+    // The name the certificate of serverName is cached and minted under: the wildcard of its parent domain
+    // ("*.cdn.example.com" for "a.cdn.example.com") if it matches the wildcard domains and the parent is not a
+    // public suffix, otherwise serverName itself
+    std::string CertificateName(const std::string& serverName) const;
+
+    // Mint the certificate of a name returned by CertificateName and store it like a generated one
+    X509_OPTR MintCertificate(const std::string& certificateName);
+
+    // Resolve the names of the upstream servers
+    Resolver& GetResolver() { return *_resolver; }
+
+    x509::CertificateCache& GetCertificateCache() { return *_certificateCache; }
+
+    // Certificates which are currently fetched, only one connection per server name fetches the certificate
+    // while the others wait for it
+    SingleFlight& GetCertificateFetches() { return _certificateFetches; }
 
   protected:
     // Configure the OpenSSL CTX object
     bool ConfigureSslContext(SSL_CTX_PTR ctx, const SslConfig& config) override;
 
-    // Handle the retrieval of the SSL Certificate either from the cache directory or by generating
-    // one on the fly from a newly established SSL connection
-    static X509_OPTR FetchCertificate(const std::string& serverName, SSL_PTR ssl, int32_t port = 443);
+    // A callback provided to OpenSSL which will be called once the ClientHello is parsed.
+    // The handshake is paused until the connection has a certificate for the requested SNI.
+    static int32_t ClientHelloCb(SSL_PTR ssl, int* ad, void* arg);
 
-    // A callback provided to OpenSSL which will be called once an SNI extention is being parsed
-    static int32_t ServerNameCb(SSL_PTR ssl, int* ad, void* arg);
+    // Callbacks of the external session cache and of the session ticket keys
+    static int NewSessionCb(SSL_PTR ssl, SSL_SESSION_PTR session);
+    static SSL_SESSION_PTR GetSessionCb(SSL_PTR ssl, const unsigned char* id, int length, int* copy);
+    static void RemoveSessionCb(SSL_CTX_PTR ctx, SSL_SESSION_PTR session);
+    static int TicketKeyCb(SSL_PTR ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher,
+                           HMAC_CTX* hmac, int encrypt);
 
   private:
-    // Create a TCP socket
-    int32_t CreateSocket();
+    class Acceptor;
+    class SignalHandler;
+
+    // Create a non-blocking listening TCP socket
+    int32_t CreateSocket(const std::string& ip, int32_t port);
+
+    // Write the metrics of the server (the Metrics of all the threads and the state of the shared parts) in the
+    // Prometheus text format
+    void RenderMetrics(std::ostream& out);
 
-    // After connection is established with the client, first peek in the first message
-    // to check if this is an HTTP CONNECT message, if so - handle it, otherwise - ignore it
-    bool HandleHttpConnect(int32_t clientSocket, SSL_PTR ssl);
+    // Keep a new certificate in the in-memory cache and the cache directory
+    void StoreCertificate(const std::string& serverName, X509_PTR certificate);
 
     std::unique_ptr<SslServerConfig> _config;
     std::unique_ptr<ThreadPool> _threadPool;
+    std::unique_ptr<x509::CertificateCache> _certificateCache;
+    std::unique_ptr<x509::CertificateAuthority> _certificateAuthority;
+    std::unique_ptr<SessionCache> _sessionCache;
+    std::unique_ptr<TicketKeys> _ticketKeys;
+    std::unique_ptr<Resolver> _resolver;
+    DomainPatterns _mintDomains;
+    DomainPatterns _wildcardDomains;
+    PublicSuffixList _publicSuffixes;
+    SingleFlight _certificateFetches;
     std::atomic<bool> _running;
     SSL_CTX_OPTR _ctx;
-    int32_t _socket;
+    std::vector<std::unique_ptr<EventLoop>> _loops;
+    std::vector<std::shared_ptr<UpstreamPool>> _upstreamPools;
+    std::vector<std::thread> _threads;
+    std::vector<int32_t> _sockets;
+    sigset_t _stopSignals;
 };
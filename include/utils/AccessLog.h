@@ -0,0 +1,101 @@
+#pragma once
+
+#include "utils/StringView.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary access log settings
+struct AccessLogConfig {
+    std::string dir;    // directory of the segment files, empty to disable the access log
+    size_t segmentSize; // bytes of a segment file
+    size_t maxSegments; // segments kept by every writer, the oldest one is removed once there are more
+};
+
+enum AccessRecordFlags : uint8_t {
+    ACCESS_COMPLETE = 1,        // the response was relayed completely
+    ACCESS_UPSTREAM_REUSED = 2, // the request was sent on an idle upstream connection
+};
+
+// A single exchange (request and response), written to the log as is.
+// Times are in microseconds, the fields are ordered so the record has no padding
+struct AccessRecord {
+    uint64_t startTime; // unix time the request head was read
+    uint64_t requestBodySize;
+    uint64_t responseBodySize;
+    uint32_t connectionId;
+    uint32_t exchange; // number of the exchange on its connection, from 1
+    uint32_t hostId;   // ids of strings in the segment, set by the writer
+    uint32_t pathId;
+    uint32_t requestHeadSize;
+    uint32_t responseHeadSize;
+    uint32_t upstreamTime; // from the request head until the upstream connection was ready
+    uint32_t waitTime;     // from sending the request to the response head
+    uint32_t transferTime; // from the response head to the end of the response
+    uint32_t totalTime;
+    uint16_t port;
+    uint16_t statusCode; // 0 if there was no response
+    uint8_t method;      // HttpMessage::HttpMethod
+    uint8_t flags;       // AccessRecordFlags
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(AccessRecord) == 72, "AccessRecord is written as is and must not have padding");
+
+// A compact binary access log, used instead of the text output of LogHttpLayer.
+// Every thread writes to segment files of its own (<dir>/access-<start time>-<writer>-<sequence>.bin), a segment
+// is a memory mapped file of a fixed size which is replaced by a new one once it is full, so writing a record is
+// a copy to memory. Host names and paths are written once per segment and records refer to them by id.
+// A segment is made of:
+//   magic "TPAL" and version (uint32)
+//   entries, a type byte followed by:
+//     STRING: varint size and the bytes, the strings of a segment are numbered from 0 in the order they appear
+//     RECORD: an AccessRecord (little endian)
+//   zeros up to the end of the file (END), the file is truncated to its used size when the segment is closed
+// The segments are decoded by tls-proxy-logcat.
+class AccessLog {
+  public:
+    enum EntryType : uint8_t { END = 0, STRING = 1, RECORD = 2 };
+
+    static constexpr char MAGIC[4] = {'T', 'P', 'A', 'L'};
+    static constexpr uint32_t VERSION = 1;
+
+    // Enable the access log, before any thread writes to it. Returns false if the directory can not be created
+    static bool Open(const AccessLogConfig& config);
+
+    static inline bool IsEnabled() { return _isEnabled; }
+
+    // Write a record from the calling thread, its string ids are set by the writer
+    static void Write(AccessRecord& record, StringView host, StringView path);
+
+  private:
+    static bool _isEnabled;
+};
+
+// Reads the entries of a segment file
+class AccessLogReader {
+  public:
+    explicit AccessLogReader(const std::string& file);
+    ~AccessLogReader();
+
+    AccessLogReader(const AccessLogReader&) = delete;
+    AccessLogReader& operator=(const AccessLogReader&) = delete;
+
+    // False if the file could not be read or is not a segment
+    inline bool IsValid() const { return _data != nullptr; }
+
+    // Read the next record, returns false at the end of the segment
+    bool Next(AccessRecord& record);
+
+    // A string of the segment by id, strings are read before the records which refer to them
+    StringView String(uint32_t id) const;
+
+  private:
+    bool ReadVarint(uint64_t& value);
+
+    const char* _data;
+    size_t _size;
+    size_t _offset;
+    std::vector<StringView> _strings; // views into the mapped file
+};
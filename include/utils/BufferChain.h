@@ -0,0 +1,88 @@
+#pragma once
+
+#include "utils/StringView.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A buffer which may be referenced from several places, its data is never changed once it is shared
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+// A part of a shared buffer
+struct BufferSlice {
+    SharedBuffer buffer;
+    size_t offset;
+    size_t size;
+
+    inline StringView View() const { return StringView(buffer->data() + offset, size); }
+};
+
+// A sequence of slices of shared buffers (a rope), used to pass data around without copying it.
+// Copying the chain only copies the slices, the buffers are shared.
+class BufferChain {
+  public:
+    BufferChain() : _slices(), _size(0) {}
+    ~BufferChain() = default;
+
+    // Add the size bytes of buffer at offset after the existing data.
+    // A slice which continues the last one in the same buffer extends it
+    inline void Append(SharedBuffer buffer, size_t offset, size_t size);
+    inline void Append(const BufferChain& other);
+
+    inline size_t Size() const { return _size; }
+    inline bool Empty() const { return _size == 0; }
+    inline const std::vector<BufferSlice>& Slices() const { return _slices; }
+
+    // Copy the data of all the slices to the end of out
+    inline void CopyTo(std::string& out) const;
+    inline std::string ToString() const;
+
+    // Release the buffers, the room for the slices is kept
+    inline void Clear();
+
+  private:
+    std::vector<BufferSlice> _slices;
+    size_t _size;
+};
+
+void BufferChain::Append(SharedBuffer buffer, size_t offset, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    _size += size;
+
+    if (!_slices.empty() && _slices.back().buffer == buffer &&
+        _slices.back().offset + _slices.back().size == offset) {
+        _slices.back().size += size;
+    } else {
+        _slices.push_back(BufferSlice{std::move(buffer), offset, size});
+    }
+}
+
+void BufferChain::Append(const BufferChain& other) {
+    for (const auto& slice : other._slices) {
+        Append(slice.buffer, slice.offset, slice.size);
+    }
+}
+
+void BufferChain::CopyTo(std::string& out) const {
+    out.reserve(out.size() + _size);
+
+    for (const auto& slice : _slices) {
+        out.append(*slice.buffer, slice.offset, slice.size);
+    }
+}
+
+std::string BufferChain::ToString() const {
+    std::string res;
+
+    CopyTo(res);
+    return res;
+}
+
+void BufferChain::Clear() {
+    _slices.clear();
+    _size = 0;
+}
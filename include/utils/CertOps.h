@@ -16,6 +16,8 @@ struct FileHandle {
         _file = fopen(file.c_str(), permissions.c_str());
     }
 
+    explicit FileHandle(FILE* file) : _file(file) {}
+
     ~FileHandle() {
         if (_file != nullptr) {
             fclose(_file);
@@ -32,14 +34,15 @@ EVP_PKEY_OPTR LoadPemKey(const std::string& file, const std::string& pass);
 X509_OPTR LoadPemCert(const std::string& file);
 
 // Clone a X509 certificate, the new certificate will be signed ny the CA certificate loaded
-// from caFile and will use the key loaded from KeyFile
+// from caFile and will use the key loaded from KeyFile.
+// This loads the CA and keys on every call, use CertificateAuthority to clone many certificates
 X509_OPTR ClonePemCert(X509_OPTR cert, const std::string& caFile, const std::string& keyFile);
 
 // Clone a X509 certificate, the new certificate will be signed ny the CA certificate loaded
 // from caFile and will use the key loaded from KeyFile
 X509_OPTR ClonePemCert(const std::string& certFile, const std::string& caFile, const std::string& keyFile);
 
-// Save a certificate to PEM file
+// Save a certificate to PEM file, the file is replaced atomically
 int SaveCertificateToPemFile(X509_PTR certificate, const std::string& certFile);
 
 // Save a key to PEM file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common/OpenSslCpp.h"
+#include <string>
+
+namespace x509 {
+
+// The CA used to sign the generated certificates.
+// The CA certificate, the CA private key and the key of the generated certificates are loaded once
+// and kept in memory. The fields which are the same for every generated certificate (version, issuer
+// and public key) are filled once in a template, so minting a certificate only copies the template,
+// patches the per host fields (serial, validity, subject and subject alternative names) and signs it.
+// Minting is thread safe, the CA is shared by all the event loops.
+class CertificateAuthority {
+  public:
+    // caFile should contain both the CA certificate and its private key
+    CertificateAuthority(const std::string& caFile, const std::string& keyFile);
+    ~CertificateAuthority() = default;
+
+    // Return true if all the keys and certificates were loaded
+    bool IsValid() const { return !_templateDer.empty(); }
+
+    // Clone a X509 certificate, the new certificate will be signed by the CA certificate and will use the
+    // generated certificates key
+    X509_OPTR Clone(X509_PTR cert);
+
+    // Mint a certificate for host without the certificate of the real server, its subject common name and its
+    // only subject alternative name are host (a DNS name or an IP address) and it is valid for MINT_VALIDITY_DAYS.
+    // A wildcard host ("*.example.com") gets a certificate of both the wildcard and its parent name.
+    // Returns null if host is not a valid name
+    X509_OPTR Mint(const std::string& host);
+
+    static constexpr long MINT_VALIDITY_DAYS = 365;
+
+  private:
+    // Create a new certificate from the template
+    X509_OPTR NewFromTemplate();
+
+    // Sign cert with the CA key and verify it was issued by the CA certificate
+    bool Sign(X509_PTR cert);
+
+    X509_OPTR _caCert;
+    EVP_PKEY_OPTR _caKey;
+    EVP_PKEY_OPTR _key;
+
+    // The template is kept DER encoded, decoding a private copy is thread safe while sharing
+    // a X509 object between threads is not (OpenSSL caches encodings inside the object)
+    std::string _templateDer;
+};
+}; // namespace x509
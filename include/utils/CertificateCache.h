@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common/OpenSslCpp.h"
+#include <array>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace x509 {
+
+// Counters of a CertificateCache
+struct CertificateCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+};
+
+// A process wide, in-memory LRU cache of ready to use X509 certificates keyed by host name.
+// The cache is split into shards, each with its own lock and LRU list, so connections handled by
+// different event loops rarely contend. A hit is a hash lookup and a reference count bump on the
+// certificate, no file system access and no parsing.
+class CertificateCache {
+  public:
+    // maxEntries bounds the number of certificates kept in memory across all shards
+    explicit CertificateCache(size_t maxEntries);
+    ~CertificateCache() = default;
+
+    // Return the certificate of host (with its own reference) or null if it is not cached
+    X509_OPTR Get(const std::string& host);
+
+    // Insert or replace the certificate of host, the cache takes its own reference
+    void Put(const std::string& host, X509_PTR certificate);
+
+    CertificateCacheStats GetStats();
+
+  private:
+    static constexpr size_t NUMBER_OF_SHARDS = 16;
+
+    struct Shard {
+        using entry_t = std::pair<std::string, X509_OPTR>;
+
+        std::mutex lock;
+        std::list<entry_t> lru; // most recently used first
+        std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& GetShard(const std::string& host);
+
+    std::array<Shard, NUMBER_OF_SHARDS> _shards;
+    size_t _maxEntriesPerShard;
+};
+}; // namespace x509
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// A set of domain name patterns, e.g. to choose the hosts a policy applies to.
+// A pattern is either a name ("example.com", matches only that name), a wildcard ("*.example.com", matches
+// the names under example.com at any depth but not example.com itself) or "*" which matches every name.
+// Names are compared case insensitively.
+class DomainPatterns {
+  public:
+    DomainPatterns() : _all(false), _names(), _suffixes() {}
+    explicit DomainPatterns(const std::vector<std::string>& patterns);
+    ~DomainPatterns() = default;
+
+    void Add(const std::string& pattern);
+
+    bool Empty() const { return !_all && _names.empty() && _suffixes.empty(); }
+
+    bool Matches(const std::string& name) const;
+
+    // Split a comma separated list of patterns
+    static std::vector<std::string> Split(const std::string& list);
+
+  private:
+    bool _all;
+    std::unordered_set<std::string> _names;
+    std::unordered_set<std::string> _suffixes; // the wildcards without their "*", e.g. ".example.com"
+};
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
-#include <iostream>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
@@ -15,10 +23,84 @@
 #define L_LEVEL L_INFO
 #endif
 
+// Asynchronous logger.
+// Every thread writes its log lines to a ring buffer of its own, without locks, and a background thread takes
+// the lines of all the rings and writes them to stdout in batches, so a thread never waits for the output.
+// A line which does not fit in the ring of its thread (the output is slower than the logging) is dropped and
+// counted, the writer reports the number of dropped lines.
+// The queued lines are written on exit.
+class Logger {
+  public:
+    // The ring buffer of a thread
+    class Ring;
+
+    static Logger& Instance();
+
+    // Queue data (complete lines) from the calling thread, returns false if it was dropped
+    bool Write(const char* data, size_t size);
+
+    // The current time, updated by the writer thread so reading it is not a system call
+    inline time_t Now() const { return _now.load(std::memory_order_relaxed); }
+
+    // The current local time as "HH:MM:SS YYYY-MM-DD", formatted at most once per second by every thread
+    const char* Timestamp();
+
+    // The number of lines which were dropped so far
+    inline uint64_t Dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    // Write all the queued lines and stop the writer thread, lines logged after that are not written
+    void Stop();
+
+  private:
+    Logger();
+    ~Logger() = delete;
+
+    // The ring of the calling thread, created on its first line
+    Ring& ThreadRing();
+
+    void Run();
+
+    // Move the queued lines of all the rings to batch, returns false if there are none
+    bool Drain(std::string& batch);
+    void Output(const std::string& batch);
+
+    std::mutex _lock; // protects _rings and _isStopped
+    std::condition_variable _wakeup;
+    std::vector<std::shared_ptr<Ring>> _rings;
+    bool _isStopped;
+    std::atomic<time_t> _now;
+    std::atomic<uint64_t> _dropped;
+    uint64_t _reportedDropped;
+    std::thread _writer;
+};
+
+class LogBuffer;
+
+// A log line of the calling thread, built in a buffer of the thread and queued to the Logger once it goes out
+// of scope
+class LogLine {
+  public:
+    LogLine();
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    inline std::ostream& Stream() { return *_stream; }
+
+  private:
+    LogBuffer* _buffer;
+    std::ostream* _stream;
+    bool _isNested; // a line logged while building another one gets a buffer of its own
+};
+
 #define LOG_MSG(level, level_str, log_msg)                                                                             \
     {                                                                                                                  \
-        if (L_LEVEL >= level)                                                                                          \
-            std::cout << "[" << level_str << "] [" << __FILENAME__ << ":" << __LINE__ << "] " << log_msg << std::endl; \
+        if (L_LEVEL >= level) {                                                                                        \
+            LogLine logLine;                                                                                           \
+            logLine.Stream() << "[" << level_str << "] [" << __FILENAME__ << ":" << __LINE__ << "] " << log_msg       \
+                             << '\n';                                                                                  \
+        }                                                                                                              \
     }
 #define LOG_ERROR(x) LOG_MSG(L_ERROR, "Error", x)
 #define LOG_INFO(x) LOG_MSG(L_INFO, "Info ", x)
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Latency histograms and counters of the proxy.
+// Every thread updates slots of its own with plain stores (no locks and no atomic read-modify-write), the slots of
+// all the threads are summed up only when the metrics are rendered, e.g. by the admin endpoint.
+// Histograms are HDR style: a bucket per power of 2 of microseconds, split into SUB_BUCKETS linear buckets, so the
+// relative error of a quantile is at most 1 / SUB_BUCKETS (12.5%) at any scale.
+class Metrics {
+  public:
+    enum class Stage : uint8_t {
+        ACCEPT,            // accepting a connection until it is registered in its loop
+        CONNECT_PEEK,      // waiting for the first bytes of a connection to tell an HTTP CONNECT from TLS
+        CERTIFICATE_FETCH, // a certificate which was not in memory, loaded or generated from the server
+        CLIENT_HANDSHAKE,  // the client TLS handshake, including the certificate fetch
+        REQUEST_HEAD,      // from the first bytes of a request until its head was read
+        UPSTREAM_CONNECT,  // resolving, connecting and the TLS handshake of a new upstream connection
+        UPSTREAM_RESPONSE, // from sending a request until its response head was read
+        RESPONSE_TRANSFER, // from the response head until the end of the response
+        EXCHANGE,          // from the request head until the end of the response
+        NUM_STAGES
+    };
+
+    enum class Counter : uint8_t {
+        CONNECTIONS,
+        CLOSED_CONNECTIONS,
+        EXCHANGES,
+        INCOMPLETE_EXCHANGES,
+        UPSTREAM_HANDSHAKES,
+        UPSTREAM_RESUMED,
+        UPSTREAM_REUSED,
+        UPSTREAM_RETRIES,
+        TIMEOUTS,
+        FULL_HANDSHAKES,
+        RESUMED_HANDSHAKES,
+        MINTED_CERTIFICATES,
+        NUM_COUNTERS
+    };
+
+    // The slots of a thread
+    struct Slot;
+
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_EXPONENT = 27; // longer durations (over about 4.5 minutes) are counted as +Inf
+    static constexpr size_t NUM_BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + 1;
+    static constexpr size_t NUM_SSL_ERRORS = 12; // SSL_ERROR_NONE ... SSL_ERROR_WANT_CLIENT_HELLO_CB
+
+    static void Count(Counter counter, uint64_t value = 1);
+
+    // Count a result of SSL_get_error
+    static void CountSslError(int32_t error);
+
+    static void Record(Stage stage, std::chrono::steady_clock::duration duration);
+
+    // Record the time since start, returns the current time
+    static std::chrono::steady_clock::time_point RecordSince(Stage stage, std::chrono::steady_clock::time_point start);
+
+    // Write the sum of all the threads in the Prometheus text format
+    static void Render(std::ostream& out);
+
+    // The bucket of a duration in microseconds, and the (inclusive) upper bound of a bucket
+    static size_t BucketOf(uint64_t value);
+    static uint64_t UpperBound(size_t bucket);
+
+  private:
+    // The slot of the calling thread, registered on its first use
+    static Slot& ThreadSlot();
+};
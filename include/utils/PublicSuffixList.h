@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+
+// The public suffixes (e.g. "com", "co.uk", "github.io") under which anyone can register a name, loaded from
+// the public suffix list (https://publicsuffix.org/list/public_suffix_list.dat).
+// A suffix is a rule of the list ("co.uk"), a name matched by one of its wildcard rules ("*.ck") unless it is
+// an exception ("!www.ck"), or a single label (the default "*" rule). Names are compared case insensitively.
+// The list is not modified once loaded, lookups are thread safe.
+class PublicSuffixList {
+  public:
+    PublicSuffixList() : _rules(), _wildcards(), _exceptions() {}
+    ~PublicSuffixList() = default;
+
+    // Read the rules from the list file, returns false if it can not be read
+    bool Load(const std::string& path);
+
+    bool IsPublicSuffix(const std::string& name) const;
+
+  private:
+    std::unordered_set<std::string> _rules;
+    std::unordered_set<std::string> _wildcards; // the wildcard rules without their "*.", e.g. "ck"
+    std::unordered_set<std::string> _exceptions;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// The addresses of a name (without a port), empty if the name does not resolve
+using addresses_t = std::vector<struct sockaddr_storage>;
+
+// A source of name resolution.
+// Lookups are made from the thread pool and may block.
+class NameSource {
+  public:
+    virtual ~NameSource() = default;
+
+    // Fill addresses with all the (IPv4 and IPv6) addresses of host, ttl may be lowered to the TTL of the answer.
+    // Returns false if the name does not resolve
+    virtual bool Lookup(const std::string& host, addresses_t& addresses, std::chrono::seconds& ttl) = 0;
+};
+
+// Resolve with getaddrinfo, which follows the system configuration (/etc/hosts, DNS...).
+// getaddrinfo does not report the TTL of the records, the TTL of the cache is used instead.
+class SystemNameSource : public NameSource {
+  public:
+    bool Lookup(const std::string& host, addresses_t& addresses, std::chrono::seconds& ttl) override;
+};
+
+// Resolve only from a file in the format of /etc/hosts (an address followed by its names on every line), e.g. to
+// run the proxy against local servers without a DNS server. The file is read once.
+class HostsFileNameSource : public NameSource {
+  public:
+    explicit HostsFileNameSource(const std::string& path) : _path(path), _hosts() {}
+
+    // Read the file, returns false if it can not be read
+    bool Load();
+
+    bool Lookup(const std::string& host, addresses_t& addresses, std::chrono::seconds& ttl) override;
+
+  private:
+    std::string _path;
+    std::unordered_map<std::string, addresses_t> _hosts;
+};
+
+// Resolver related configuration
+struct ResolverConfig {
+    std::string hostsFile;            // resolve from this file instead of the system resolver, empty to disable
+    std::chrono::seconds ttl;         // the time names which resolved are cached
+    std::chrono::seconds negativeTtl; // the time names which did not resolve are cached
+};
+
+// Counters of a Resolver
+struct ResolverStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t entries;
+};
+
+// Resolve the names of the upstream servers without blocking the event loops.
+// Lookups run on the thread pool, concurrent lookups of the same name are made once and their answer (also a
+// name which does not resolve) is cached for its TTL.
+class Resolver {
+  public:
+    using callback_t = std::function<void(const addresses_t&)>;
+
+    Resolver(ThreadPool& threadPool, std::unique_ptr<NameSource> source, const ResolverConfig& config);
+    ~Resolver() = default;
+
+    // Look host up in the cache only.
+    // Returns true if it has an answer, which is set in addresses
+    bool Lookup(const std::string& host, addresses_t& addresses);
+
+    // Resolve host on the thread pool, callback is called from the thread pool with the addresses and should hand
+    // them over to the caller's thread (e.g. using EventLoop::Post)
+    void Resolve(const std::string& host, const callback_t& callback);
+
+    // Resolve host in the background unless it is cached, so it is ready once a connection needs it
+    void Prefetch(const std::string& host);
+
+    ResolverStats GetStats();
+
+  private:
+    static constexpr size_t MAX_ENTRIES = 10000;
+
+    struct Entry {
+        addresses_t addresses;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    // Resolve host with the source and call all the callbacks which are waiting for it
+    void Complete(const std::string& host);
+
+    ThreadPool& _threadPool;
+    std::unique_ptr<NameSource> _source;
+    ResolverConfig _config;
+    std::mutex _lock;
+    std::unordered_map<std::string, Entry> _cache;
+    std::unordered_map<std::string, std::vector<callback_t>> _inFlight;
+    uint64_t _hits;
+    uint64_t _misses;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/OpenSslCpp.h"
+#include <array>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Counters of a SessionCache
+struct SessionCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+};
+
+// A process wide, in-memory LRU cache of TLS sessions keyed by session id, used as the external session cache of
+// the server SSL_CTX (instead of the internal one, which has a single lock).
+// Like the CertificateCache it is split into shards, each with its own lock and LRU list. Sessions which expired
+// are removed once they are looked up.
+class SessionCache {
+  public:
+    // maxEntries bounds the number of sessions kept in memory across all shards
+    explicit SessionCache(size_t maxEntries);
+    ~SessionCache() = default;
+
+    // Return the session (with its own reference) or null if it is not cached or expired
+    SSL_SESSION_OPTR Get(const std::string& id);
+
+    // Insert or replace the session, the cache takes its own reference
+    void Put(const std::string& id, SSL_SESSION_PTR session);
+
+    void Remove(const std::string& id);
+
+    SessionCacheStats GetStats();
+
+  private:
+    static constexpr size_t NUMBER_OF_SHARDS = 16;
+
+    struct Shard {
+        using entry_t = std::pair<std::string, SSL_SESSION_OPTR>;
+
+        std::mutex lock;
+        std::list<entry_t> lru; // most recently used first
+        std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& GetShard(const std::string& id);
+
+    std::array<Shard, NUMBER_OF_SHARDS> _shards;
+    size_t _maxEntriesPerShard;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A utility class to deduplicate concurrent work on the same key.
+// The first caller to join a key becomes the leader and does the work, callers joining while the
+// work is in flight become followers and are called back with the leader's result once it completes.
+// Followers never block, the callback is called from the leader's thread and should hand the
+// result over to the follower's own thread (e.g. using EventLoop::Post).
+class SingleFlight {
+  public:
+    enum class Outcome : uint8_t {
+        DONE,     // the work succeeded
+        FAILED,   // the work failed, the followers should fail too
+        ABANDONED // the leader gave up for a reason of its own, the followers should join again (one of them leads)
+    };
+
+    using callback_t = std::function<void(Outcome)>;
+
+    SingleFlight() = default;
+    ~SingleFlight() = default;
+
+    // Return true if the caller is the leader for key and must call Complete once done,
+    // otherwise callback will be called with the result of the leader
+    bool Join(const std::string& key, const callback_t& callback);
+
+    // Complete the work on key and call all the followers with the outcome
+    void Complete(const std::string& key, Outcome outcome);
+
+  private:
+    std::mutex _lock;
+    std::unordered_map<std::string, std::vector<callback_t>> _inFlight;
+};
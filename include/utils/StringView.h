@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// A non owning, read only slice of a character buffer (C++14 has no std::string_view).
+// The viewed buffer must outlive the view and must not be modified while the view is used.
+class StringView {
+  public:
+    static constexpr size_t npos = std::string::npos;
+
+    constexpr StringView() : _data(nullptr), _size(0) {}
+    constexpr StringView(const char* data, size_t size) : _data(data), _size(size) {}
+    StringView(const char* s) : _data(s), _size(strlen(s)) {}
+    StringView(const std::string& s) : _data(s.data()), _size(s.size()) {}
+
+    inline const char* data() const { return _data; }
+    inline size_t size() const { return _size; }
+    inline bool empty() const { return _size == 0; }
+    inline const char* begin() const { return _data; }
+    inline const char* end() const { return _data + _size; }
+    inline char operator[](size_t i) const { return _data[i]; }
+
+    inline StringView substr(size_t pos, size_t count = npos) const {
+        pos = std::min(pos, _size);
+        return StringView(_data + pos, std::min(count, _size - pos));
+    }
+
+    inline size_t find(char c, size_t pos = 0) const {
+        if (pos >= _size) {
+            return npos;
+        }
+
+        auto res = static_cast<const char*>(memchr(_data + pos, c, _size - pos));
+        return res == nullptr ? npos : res - _data;
+    }
+
+    inline size_t rfind(char c) const {
+        for (size_t i = _size; i > 0; i--) {
+            if (_data[i - 1] == c) {
+                return i - 1;
+            }
+        }
+
+        return npos;
+    }
+
+    inline size_t find(StringView s, size_t pos = 0) const {
+        if (s._size > _size) {
+            return npos;
+        }
+
+        for (size_t i = pos; i + s._size <= _size; i++) {
+            if (memcmp(_data + i, s._data, s._size) == 0) {
+                return i;
+            }
+        }
+
+        return npos;
+    }
+
+    inline bool StartsWith(StringView s) const { return _size >= s._size && memcmp(_data, s._data, s._size) == 0; }
+
+    // Remove leading and trailing spaces and tabs
+    inline StringView Trim() const {
+        size_t start = 0, end = _size;
+
+        while (start < end && (_data[start] == ' ' || _data[start] == '\t')) {
+            start++;
+        }
+
+        while (end > start && (_data[end - 1] == ' ' || _data[end - 1] == '\t')) {
+            end--;
+        }
+
+        return StringView(_data + start, end - start);
+    }
+
+    inline bool EqualsIgnoreCase(StringView s) const {
+        if (_size != s._size) {
+            return false;
+        }
+
+        for (size_t i = 0; i < _size; i++) {
+            if (tolower(static_cast<unsigned char>(_data[i])) != tolower(static_cast<unsigned char>(s._data[i]))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline std::string ToString() const { return std::string(_data, _size); }
+
+    inline bool operator==(StringView s) const { return _size == s._size && memcmp(_data, s._data, _size) == 0; }
+    inline bool operator!=(StringView s) const { return !(*this == s); }
+
+  private:
+    const char* _data;
+    size_t _size;
+};
+
+inline std::ostream& operator<<(std::ostream& os, StringView s) { return os.write(s.data(), s.size()); }
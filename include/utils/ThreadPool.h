@@ -27,6 +27,9 @@ class ThreadPool {
     // Add new task to handle by the thread pool
     void AddTask(const task_t& task);
 
+    // The number of tasks waiting for a free thread, read without locking the queue
+    inline size_t QueueDepth() const { return _queueDepth.load(std::memory_order_relaxed); }
+
   private:
     // Loop untill the thread pool is stoped, once there is a work to be done
     // dispatch a free thread to handle it
@@ -35,6 +38,7 @@ class ThreadPool {
     std::mutex _qLock;
     std::condition_variable _qCv;
     std::deque<task_t> _taskQ;
+    std::atomic<size_t> _queueDepth;
     std::vector<std::thread> _threads;
     std::atomic<bool> _running;
     uint8_t _numberOfThreads;
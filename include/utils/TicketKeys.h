@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+extern "C" {
+using EVP_CIPHER_CTX = struct evp_cipher_ctx_st;
+using HMAC_CTX = struct hmac_ctx_st;
+};
+
+// The keys which encrypt the TLS session tickets of the server, they are only held in memory.
+// A new key is generated every rotation period, new tickets are encrypted with it and the previous key still
+// decrypts (and renews) the tickets it encrypted, so a ticket is accepted for one to two periods.
+class TicketKeys {
+  public:
+    static constexpr size_t NAME_SIZE = 16;
+
+    explicit TicketKeys(std::chrono::seconds rotation);
+    ~TicketKeys() = default;
+
+    // Implements the ticket key callback of OpenSSL (SSL_CTX_set_tlsext_ticket_key_cb).
+    // Returns 1 if the key was set up, 2 for a ticket to be renewed, 0 for an unknown ticket and -1 on error
+    int32_t Setup(uint8_t* name, uint8_t* iv, EVP_CIPHER_CTX* cipher, HMAC_CTX* hmac, bool encrypt);
+
+  private:
+    struct Key {
+        uint8_t name[NAME_SIZE];
+        uint8_t aesKey[32];
+        uint8_t hmacKey[32];
+        std::chrono::steady_clock::time_point created;
+    };
+
+    // Generate a new key once the current one is older than the rotation period, must be called with _lock held
+    bool Rotate();
+
+    std::chrono::seconds _rotation;
+    std::mutex _lock;
+    std::deque<Key> _keys; // the current key first
+};
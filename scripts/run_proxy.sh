@@ -1,7 +1,7 @@
 #!/bin/bash
 
 function usage() {
-    echo "Usage: $0 [ --mode <1/2, 1 - explicit only, 2 - transparent and explicit> ] [ --ip <proxy-ip> ] [ --port <proxy-port> ] [ --ca <ca certificate to use> ] [ -v to run with valgrind ] [ -g to run with gdb ] [ -h print help]" 1>&2
+    echo "Usage: $0 [ --mode <1/2, 1 - explicit only, 2 - transparent and explicit> ] [ --ip <proxy-ip> ] [ --port <proxy-port> ] [ --ca <ca certificate to use> ] [ --workers <number of event loop threads> ] [ --access-log <binary access log dir> ] [ --access-log-segment-size <MB> ] [ --access-log-segments <number of segments> ] [ --admin-port <loopback metrics port> ] [ --session-cache-size <number of sessions> ] [ --session-timeout <seconds> ] [ --ticket-key-rotation <seconds> ] [ --hosts-file <hosts file to resolve from> ] [ --dns-ttl <seconds> ] [ --dns-negative-ttl <seconds> ] [ --mint-domains <comma separated host patterns> ] [ --wildcard-domains <comma separated host patterns> ] [ --public-suffix-list <public suffix list file> ] [ -v to run with valgrind ] [ -g to run with gdb ] [ -h print help]" 1>&2
     exit 1
 }
 
@@ -13,7 +13,7 @@ MODE=2
 RUNNER=None
 
 ALL_OPTS=($@)
-OPTIONS=$(getopt -o vgh --long mode:,ip:,port:,ca: -n ${APP_NAME} -- "$@" 2> /dev/null)
+OPTIONS=$(getopt -o vgh --long mode:,ip:,port:,ca:,workers:,cert-cache-size:,cert-dir:,upstream-max-idle:,upstream-max-idle-per-host:,upstream-idle-timeout:,client-idle-timeout:,access-log:,access-log-segment-size:,access-log-segments:,admin-port:,session-cache-size:,session-timeout:,ticket-key-rotation:,hosts-file:,dns-ttl:,dns-negative-ttl:,mint-domains:,wildcard-domains:,public-suffix-list: -n ${APP_NAME} -- "$@" 2> /dev/null)
 
 eval set -- "${OPTIONS}"
 
@@ -23,6 +23,7 @@ while true; do
         --ip) IP=$2; shift 2;;
         --port) PORT=$2; shift 2;;
         --ca) CA_CERTIFICATE=$2; shift 2;;
+        --workers|--cert-cache-size|--cert-dir|--upstream-max-idle|--upstream-max-idle-per-host|--upstream-idle-timeout|--client-idle-timeout|--access-log|--access-log-segment-size|--access-log-segments|--admin-port|--session-cache-size|--session-timeout|--ticket-key-rotation|--hosts-file|--dns-ttl|--dns-negative-ttl|--mint-domains|--wildcard-domains|--public-suffix-list) shift 2;;
         -g) RUNNER=gdb; shift;;
         -v) RUNNER=valgrind; shift;;
         -h) usage;;
@@ -2,44 +2,40 @@
 #include "ssl/SslServer.h"
 #include "utils/Logger.h"
 
+#include <chrono>
 #include <csignal>
 #include <cstdlib>
 #include <getopt.h>
 #include <iostream>
 #include <openssl/evp.h>
+#include <pthread.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
 using namespace std;
 
-static unique_ptr<SslServer> server = nullptr;
-
-// Handle clean exit when pressing CTRL+C
-void SignalCallbackHandler(int signum);
-
 // Read CLI arguments and generate server configuration from it
 unique_ptr<SslServerConfig> GetServerConfig(int argc, char* const argv[]);
 
 int main(int argc, char* const argv[]) {
-    signal(SIGINT, SignalCallbackHandler);
-
-    server = make_unique<SslServer>(std::move(GetServerConfig(argc, argv)));
-    server->Start();
+    sigset_t signals;
 
-    return 0;
-}
+    // Handle clean exit when pressing CTRL+C or on kill, the signals are blocked here so every thread of the
+    // server inherits the mask and the server receives them in its first event loop
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
 
-void SignalCallbackHandler(int signum) {
-    LOG_INFO("Stopping server...");
-
-    if (server != nullptr) {
-        server->Stop();
-        server.reset();
-    }
+    auto server = make_unique<SslServer>(std::move(GetServerConfig(argc, argv)));
+    server->StopOnSignals(signals);
+    server->Start();
+    server.reset();
 
     EVP_cleanup();
 
-    exit(signum);
+    return 0;
 }
 
 unique_ptr<SslServerConfig> GetServerConfig(int argc, char* const argv[]) {
@@ -53,11 +49,46 @@ unique_ptr<SslServerConfig> GetServerConfig(int argc, char* const argv[]) {
     conf->listenIp = "192.168.244.1";
     conf->caCertificateFile = "./scerts/ca_cert.pem";
     conf->keyFile = "./scerts/key.pem";
+    conf->numberOfWorkers = std::thread::hardware_concurrency();
+    conf->certificateCacheSize = 10000;
+    conf->certificatesDir = "./certs";
+    conf->upstreamPool.maxIdle = 1024;
+    conf->upstreamPool.maxIdlePerHost = 8;
+    conf->upstreamPool.idleTimeout = std::chrono::seconds(30);
+    conf->clientIdleTimeout = std::chrono::seconds(60);
+    conf->accessLog.segmentSize = 64 << 20;
+    conf->accessLog.maxSegments = 16;
+    conf->adminPort = 0;
+    conf->sessionCacheSize = 20000;
+    conf->sessionTimeout = std::chrono::seconds(7200);
+    conf->ticketKeyRotation = std::chrono::seconds(3600);
+    conf->resolver.ttl = std::chrono::seconds(60);
+    conf->resolver.negativeTtl = std::chrono::seconds(10);
+    conf->publicSuffixFile = "/usr/share/publicsuffix/public_suffix_list.dat";
 
     static struct option longOptions[] = {
         {"ciphersuites", required_argument, nullptr, 0}, {"port", required_argument, nullptr, 0},
         {"ip", required_argument, nullptr, 0},           {"ca", required_argument, nullptr, 0},
-        {"key", required_argument, nullptr, 0},          {nullptr, 0, nullptr, 0}};
+        {"key", required_argument, nullptr, 0},          {"workers", required_argument, nullptr, 0},
+        {"cert-cache-size", required_argument, nullptr, 0}, {"cert-dir", required_argument, nullptr, 0},
+        {"upstream-max-idle", required_argument, nullptr, 0},
+        {"upstream-max-idle-per-host", required_argument, nullptr, 0},
+        {"upstream-idle-timeout", required_argument, nullptr, 0},
+        {"client-idle-timeout", required_argument, nullptr, 0},
+        {"access-log", required_argument, nullptr, 0},
+        {"access-log-segment-size", required_argument, nullptr, 0},
+        {"access-log-segments", required_argument, nullptr, 0},
+        {"admin-port", required_argument, nullptr, 0},
+        {"session-cache-size", required_argument, nullptr, 0},
+        {"session-timeout", required_argument, nullptr, 0},
+        {"ticket-key-rotation", required_argument, nullptr, 0},
+        {"hosts-file", required_argument, nullptr, 0},
+        {"dns-ttl", required_argument, nullptr, 0},
+        {"dns-negative-ttl", required_argument, nullptr, 0},
+        {"mint-domains", required_argument, nullptr, 0},
+        {"wildcard-domains", required_argument, nullptr, 0},
+        {"public-suffix-list", required_argument, nullptr, 0},
+        {nullptr, 0, nullptr, 0}};
 
     while ((res = getopt_long(argc, argv, "", longOptions, &optionIndex)) != -1) {
         switch (res) {
@@ -78,6 +109,66 @@ unique_ptr<SslServerConfig> GetServerConfig(int argc, char* const argv[]) {
             case 4:
                 conf->keyFile = std::string(optarg);
                 break;
+            case 5:
+                conf->numberOfWorkers = std::stoi(optarg);
+                break;
+            case 6:
+                conf->certificateCacheSize = std::stoul(optarg);
+                break;
+            case 7:
+                conf->certificatesDir = std::string(optarg);
+                break;
+            case 8:
+                conf->upstreamPool.maxIdle = std::stoul(optarg);
+                break;
+            case 9:
+                conf->upstreamPool.maxIdlePerHost = std::stoul(optarg);
+                break;
+            case 10:
+                conf->upstreamPool.idleTimeout = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 11:
+                conf->clientIdleTimeout = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 12:
+                conf->accessLog.dir = std::string(optarg);
+                break;
+            case 13:
+                conf->accessLog.segmentSize = std::stoul(optarg) << 20;
+                break;
+            case 14:
+                conf->accessLog.maxSegments = std::stoul(optarg);
+                break;
+            case 15:
+                conf->adminPort = std::stoi(optarg);
+                break;
+            case 16:
+                conf->sessionCacheSize = std::stoul(optarg);
+                break;
+            case 17:
+                conf->sessionTimeout = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 18:
+                conf->ticketKeyRotation = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 19:
+                conf->resolver.hostsFile = std::string(optarg);
+                break;
+            case 20:
+                conf->resolver.ttl = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 21:
+                conf->resolver.negativeTtl = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 22:
+                conf->mintDomains = DomainPatterns::Split(optarg);
+                break;
+            case 23:
+                conf->wildcardDomains = DomainPatterns::Split(optarg);
+                break;
+            case 24:
+                conf->publicSuffixFile = std::string(optarg);
+                break;
             }
             break;
         default:
@@ -0,0 +1,205 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "core/EventLoop.h"
+#include "utils/Logger.h"
+
+constexpr int32_t MAX_EVENTS = 256;
+constexpr uint64_t WAKEUP_TOKEN = UINT64_MAX;
+
+EventLoop::EventLoop()
+    : _epoll(epoll_create1(EPOLL_CLOEXEC)), _wakeup(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), _running(false),
+      _threadId(), _watches(), _generation(0), _timers(), _timerDeadlines(), _nextTimerId(0) {
+    struct epoll_event ev;
+
+    if (_epoll < 0 || _wakeup < 0) {
+        LOG_ERROR("Unable to create event loop (" << std::strerror(errno) << ")");
+        return;
+    }
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = WAKEUP_TOKEN;
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeup, &ev) < 0) {
+        LOG_ERROR("Unable to register wakeup descriptor (" << std::strerror(errno) << ")");
+    }
+}
+
+EventLoop::~EventLoop() {
+    _watches.clear();
+
+    if (_wakeup >= 0) {
+        close(_wakeup);
+    }
+
+    if (_epoll >= 0) {
+        close(_epoll);
+    }
+}
+
+bool EventLoop::Add(int32_t fd, std::shared_ptr<EventHandler> handler) {
+    struct epoll_event ev;
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (static_cast<size_t>(fd) >= _watches.size()) {
+        _watches.resize(fd + 1);
+    }
+
+    // the generation is part of the epoll token so events which were already fetched for a
+    // previous owner of a reused fd number are not delivered to the new handler
+    _watches[fd] = Watch{std::move(handler), ++_generation};
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = (static_cast<uint64_t>(_watches[fd].generation) << 32) | static_cast<uint32_t>(fd);
+
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        LOG_ERROR("Unable to register descriptor " << fd << " (" << std::strerror(errno) << ")");
+        _watches[fd].handler.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void EventLoop::Remove(int32_t fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _watches.size() || _watches[fd].handler == nullptr) {
+        return;
+    }
+
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    _watches[fd].handler.reset();
+}
+
+uint64_t EventLoop::AddTimer(std::chrono::milliseconds delay, task_t task) {
+    uint64_t timerId = ++_nextTimerId;
+    auto deadline = clock_t::now() + delay;
+
+    _timers.emplace(std::make_pair(deadline, timerId), std::move(task));
+    _timerDeadlines.emplace(timerId, deadline);
+
+    return timerId;
+}
+
+void EventLoop::CancelTimer(uint64_t timerId) {
+    auto it = _timerDeadlines.find(timerId);
+
+    if (it != _timerDeadlines.end()) {
+        _timers.erase(std::make_pair(it->second, timerId));
+        _timerDeadlines.erase(it);
+    }
+}
+
+void EventLoop::Post(task_t task) {
+    uint64_t one = 1;
+
+    {
+        std::unique_lock<std::mutex> l(_postLock);
+        _posted.push_back(std::move(task));
+    }
+
+    if (write(_wakeup, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Unable to wake up event loop (" << std::strerror(errno) << ")");
+    }
+}
+
+void EventLoop::Stop() {
+    uint64_t one = 1;
+
+    _running = false;
+
+    // write() is async-signal-safe, Stop() may be called from a signal handler
+    if (write(_wakeup, &one, sizeof(one)) < 0) {
+        // the loop will notice _running on its next wakeup
+    }
+}
+
+int32_t EventLoop::NextTimeout() const {
+    if (_timers.empty()) {
+        return -1;
+    }
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(_timers.begin()->first.first -
+                                                                           clock_t::now());
+
+    // round up so we don't spin on timers that expire in less than a millisecond
+    return remaining.count() < 0 ? 0 : static_cast<int32_t>(remaining.count()) + 1;
+}
+
+void EventLoop::RunExpiredTimers() {
+    auto now = clock_t::now();
+
+    while (!_timers.empty() && _timers.begin()->first.first <= now) {
+        auto it = _timers.begin();
+        task_t task = std::move(it->second);
+
+        _timerDeadlines.erase(it->first.second);
+        _timers.erase(it);
+
+        task();
+    }
+}
+
+void EventLoop::RunPostedTasks() {
+    std::vector<task_t> tasks;
+    uint64_t value = 0;
+
+    if (read(_wakeup, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Unable to read wakeup descriptor (" << std::strerror(errno) << ")");
+    }
+
+    {
+        std::unique_lock<std::mutex> l(_postLock);
+        tasks.swap(_posted);
+    }
+
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::Run() {
+    struct epoll_event events[MAX_EVENTS];
+
+    _threadId = std::this_thread::get_id();
+    _running = true;
+
+    while (_running) {
+        int32_t n = epoll_wait(_epoll, events, MAX_EVENTS, NextTimeout());
+
+        if (n < 0) {
+            if (errno != EINTR) {
+                LOG_ERROR("Error in epoll_wait (" << std::strerror(errno) << ")");
+                break;
+            }
+
+            continue;
+        }
+
+        for (int32_t i = 0; i < n; i++) {
+            if (events[i].data.u64 == WAKEUP_TOKEN) {
+                RunPostedTasks();
+                continue;
+            }
+
+            auto fd = static_cast<int32_t>(events[i].data.u64 & 0xffffffff);
+            auto generation = static_cast<uint32_t>(events[i].data.u64 >> 32);
+
+            if (static_cast<size_t>(fd) >= _watches.size() || _watches[fd].generation != generation) {
+                continue;
+            }
+
+            // hold a reference, the handler may remove itself from the loop while handling the event
+            std::shared_ptr<EventHandler> handler = _watches[fd].handler;
+            if (handler != nullptr) {
+                handler->OnEvent(fd, events[i].events);
+            }
+        }
+
+        RunExpiredTimers();
+    }
+}
@@ -0,0 +1,161 @@
+#include "core/MetricsEndpoint.h"
+#include "utils/Logger.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+constexpr auto CONNECTION_TIMEOUT = std::chrono::milliseconds(5000); // to read the request and write the response
+
+// A single request of the endpoint, the connection is closed once it was answered or timed out
+class MetricsEndpoint::Connection : public EventHandler, public std::enable_shared_from_this<Connection> {
+  public:
+    Connection(MetricsEndpoint& endpoint, int32_t fd)
+        : _endpoint(endpoint), _fd(fd), _request(), _response(), _offset(0), _timer(0), _isClosed(false) {}
+
+    // Start the timer of the connection, called once it was added to the loop
+    void Start() {
+        std::weak_ptr<Connection> self = shared_from_this();
+
+        _timer = _endpoint._loop.AddTimer(CONNECTION_TIMEOUT, [self] {
+            auto connection = self.lock();
+
+            if (connection != nullptr) {
+                LOG_TRACE("Admin connection timed out");
+                connection->_timer = 0;
+                connection->Close();
+            }
+        });
+    }
+
+    void OnEvent(int32_t fd, uint32_t events) override {
+        if (_isClosed) {
+            return;
+        }
+
+        if (_response.empty() && !ReadRequest()) {
+            return;
+        }
+
+        while (_offset < _response.size()) {
+            ssize_t bytes = write(_fd, _response.data() + _offset, _response.size() - _offset);
+
+            if (bytes < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    Close();
+                }
+
+                return;
+            }
+
+            _offset += bytes;
+        }
+
+        Close();
+    }
+
+  private:
+    // Returns true once the request head was read and the response is ready.
+    // A client which half-closes its side after the request line (e.g. printf "GET /metrics HTTP/1.0\r\n" | nc)
+    // is answered as well, the rest of the head is not needed for the response.
+    bool ReadRequest() {
+        char buffer[1024];
+        bool isEof = false;
+
+        for (;;) {
+            ssize_t bytes = read(_fd, buffer, sizeof(buffer));
+
+            if (bytes > 0) {
+                _request.append(buffer, bytes);
+            } else if (bytes == 0) {
+                isEof = true;
+                break;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                Close();
+                return false;
+            }
+        }
+
+        bool isComplete = _request.find("\r\n\r\n") != std::string::npos ||
+                          (isEof && _request.find('\n') != std::string::npos);
+
+        if (!isComplete) {
+            if (isEof || _request.size() >= MAX_REQUEST_SIZE) {
+                Close();
+            }
+
+            return false;
+        }
+
+        _response = _endpoint.Respond(_request);
+        return true;
+    }
+
+    void Close() {
+        if (_isClosed) {
+            return;
+        }
+
+        _isClosed = true;
+        _endpoint._loop.CancelTimer(_timer);
+        _endpoint._loop.Remove(_fd);
+        close(_fd);
+    }
+
+    MetricsEndpoint& _endpoint;
+    int32_t _fd;
+    std::string _request;
+    std::string _response;
+    size_t _offset;
+    uint64_t _timer;
+    bool _isClosed;
+};
+
+void MetricsEndpoint::OnEvent(int32_t fd, uint32_t events) {
+    for (;;) {
+        int32_t client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Unable to accept admin connection (" << std::strerror(errno) << ")");
+            }
+
+            return;
+        }
+
+        auto connection = std::make_shared<Connection>(*this, client);
+
+        if (!_loop.Add(client, connection)) {
+            close(client);
+            continue;
+        }
+
+        connection->Start();
+    }
+}
+
+std::string MetricsEndpoint::Respond(const std::string& request) {
+    std::ostringstream body;
+    std::string status = "200 OK";
+
+    if (request.compare(0, 13, "GET /metrics ") == 0) {
+        _render(body);
+    } else {
+        status = "404 Not Found";
+        body << "Not found, the metrics are served on /metrics\n";
+    }
+
+    std::string content = body.str();
+
+    return "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+           std::to_string(content.size()) + "\r\nConnection: close\r\n\r\n" + content;
+}
@@ -0,0 +1,1106 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/HandlerLayer.h"
+#include "core/ProxyConnection.h"
+#include "core/UpstreamConnector.h"
+#include "core/UpstreamPool.h"
+#include "http/HttpMessage.h"
+#include "http/HttpFramer.h"
+#include "http/HttpMessageBuilder.h"
+#include "middleware/BackendSslLayer.h"
+#include "middleware/FrontendSslLayer.h"
+#include "ssl/SslClient.h"
+#include "ssl/SslServer.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+
+constexpr auto UPSTREAM_CONNECT_TIMEOUT = std::chrono::milliseconds(2000);
+constexpr auto CERTIFICATE_WAIT_TIMEOUT = 2 * UPSTREAM_CONNECT_TIMEOUT; // the fetcher is bounded by its upstream
+constexpr auto RELAY_TIMEOUT = std::chrono::milliseconds(30000);
+constexpr size_t MAX_HEAD_SIZE = 65536;
+constexpr size_t PIPE_BUFFER_SIZE = 16384;
+constexpr int32_t PEEK_SIZE = 1024;
+constexpr char TLS_HANDSHAKE_RECORD = 0x16;
+
+static std::atomic<uint32_t> nextConnectionId(0);
+
+static uint32_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+ProxyConnection::ProxyConnection(SslServer& server, EventLoop& loop, UpstreamPool& upstreamPool, SSL_OPTR ssl)
+    : _id(++nextConnectionId), _server(server), _loop(loop), _upstreamPool(upstreamPool), _state(State::PEEK_CONNECT),
+      _frontend(std::make_unique<FrontendSslLayer>(std::move(ssl))), _backend(nullptr),
+      _upstreamState(UpstreamState::NONE), _isBackendReused(false), _isBackendIdle(false), _client(nullptr),
+      _connector(nullptr), _middleware(), _lastMessageId(0), _serverName(""), _serverPort(443), _isHttpConnect(false),
+      _certificateName(""), _certificate(nullptr, X509_free), _isCertificateFetcher(false), _timer(0),
+      _upstreamTimer(0), _connectReply(""), _writeOffset(0), _requestPipe(), _responsePipe(), _requestReplay(),
+      _isRequestReplayable(false), _isServerClosed(false), _exchanges(0), _access(), _accessPath(), _exchangeStart(),
+      _stageStart(), _certificateStart(), _upstreamStart() {}
+
+ProxyConnection::~ProxyConnection() { LOG_TRACE("Connection to " << _serverName << " destroyed"); }
+
+void ProxyConnection::Start() {
+    SSL_set_ex_data(_frontend->GetSsl(), 0, this);
+
+    if (!_loop.Add(_frontend->GetSocket(), shared_from_this())) {
+        Close(false);
+        return;
+    }
+
+    _stageStart = std::chrono::steady_clock::now();
+    Drive();
+}
+
+void ProxyConnection::OnEvent(int32_t fd, uint32_t events) {
+    if ((events & EPOLLERR) && _frontend != nullptr && fd == _frontend->GetSocket()) {
+        Close(false);
+        return;
+    }
+
+    Drive();
+}
+
+void ProxyConnection::Drive() {
+    bool progress = true;
+
+    while (progress && _state != State::CLOSED) {
+        // the upstream handshake runs alongside the client side, e.g. while the client handshakes
+        bool upstreamProgress = _upstreamState == UpstreamState::HANDSHAKE && UpstreamHandshake();
+
+        switch (_state) {
+        case State::PEEK_CONNECT:
+            progress = HandleHttpConnect();
+
+            // the client handshake (and the certificate fetch) starts once the first bytes were inspected
+            if (_state != State::PEEK_CONNECT && _state != State::CLOSED) {
+                _stageStart = Metrics::RecordSince(Metrics::Stage::CONNECT_PEEK, _stageStart);
+            }
+            break;
+        case State::WRITE_CONNECT_REPLY:
+            progress = WriteConnectReply();
+            break;
+        case State::CLIENT_HANDSHAKE:
+            progress = ClientHandshake();
+            break;
+        case State::READ_REQUEST_HEAD:
+            progress = ReadRequestHead();
+            break;
+        case State::RELAY:
+            progress = Relay();
+            break;
+        case State::WAIT_UPSTREAM:    // waiting for the resolver, the UpstreamConnector or the upstream handshake
+        case State::WAIT_CERTIFICATE: // waiting for the connection which fetches the certificate
+        case State::CLOSED:
+        default:
+            progress = false;
+            break;
+        }
+
+        progress = progress || upstreamProgress;
+    }
+}
+
+bool ProxyConnection::HandleHttpConnect() {
+    char content[PEEK_SIZE];
+    int32_t socket = _frontend->GetSocket();
+    ssize_t bytes = recv(socket, content, sizeof(content) - 1, MSG_PEEK);
+
+    if (bytes < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+
+        Close(false);
+        return true;
+    } else if (bytes == 0) {
+        Close(false);
+        return true;
+    }
+
+    // A TLS connection starts with a handshake record, anything else may be an HTTP CONNECT
+    if (content[0] == TLS_HANDSHAKE_RECORD) {
+        _state = State::CLIENT_HANDSHAKE;
+        return true;
+    }
+
+    std::string peeked(content, bytes);
+    size_t headersEnd = peeked.find("\r\n\r\n");
+
+    if (headersEnd == std::string::npos) {
+        if (bytes < PEEK_SIZE - 1) {
+            return false; // wait for the rest of the request
+        }
+
+        _state = State::CLIENT_HANDSHAKE;
+        return true;
+    }
+
+    peeked.resize(headersEnd + 4);
+
+    try {
+        HttpMessage httpMessage(peeked);
+        if (httpMessage.IsRequest() && httpMessage.Method() == HttpMessage::HttpMethod::CONNECT &&
+            httpMessage.Headers().Has(HttpHeaderId::HOST) &&
+            recv(socket, content, peeked.size(), 0) == static_cast<ssize_t>(peeked.size())) {
+            LOG_TRACE("Handling HTTP CONNECT");
+            HttpMessageBuilder msg(false);
+            std::string& status = msg.Status();
+
+            status = "200 Connection Established";
+            msg.Headers().Set(HttpHeaders::NameOf(HttpHeaderId::HOST), httpMessage.Headers().Get(HttpHeaderId::HOST));
+            _connectReply = msg.Build().ToString();
+
+            _isHttpConnect = true;
+            _serverName = httpMessage.Host();
+            _serverPort = httpMessage.Port();
+            _certificateName = _server.CertificateName(_serverName);
+
+            // the name is resolved while the certificate is looked up, in case it needs an upstream connection
+            _server.GetResolver().Prefetch(_serverName);
+
+            AcquireCertificate();
+            return true;
+        }
+    } catch (std::invalid_argument* e) {
+        LOG_TRACE("Not an HTTP Connect");
+    } catch (const std::exception& e) {
+        LOG_TRACE("Not an HTTP Connect (" << e.what() << ")");
+    }
+
+    _state = State::CLIENT_HANDSHAKE;
+    return true;
+}
+
+void ProxyConnection::AcquireCertificate() {
+    std::weak_ptr<ProxyConnection> self = shared_from_this();
+    EventLoop& loop = _loop;
+
+    if ((_certificate = _server.GetCertificateCache().Get(_certificateName)) != nullptr) {
+        ContinueWithCertificate();
+        PreconnectUpstream();
+        return;
+    }
+
+    // a waiting connection looks the certificate up again once it is ready
+    if (_certificateStart == std::chrono::steady_clock::time_point()) {
+        _certificateStart = std::chrono::steady_clock::now();
+    }
+
+    // the callback is called from the thread of the connection which fetches the certificate
+    bool isFetcher =
+        _server.GetCertificateFetches().Join(_certificateName, [self, &loop](SingleFlight::Outcome outcome) {
+            loop.Post([self, outcome] {
+                auto connection = self.lock();
+
+                if (connection != nullptr) {
+                    connection->OnCertificateReady(outcome);
+                }
+            });
+        });
+
+    if (!isFetcher) {
+        LOG_TRACE("Waiting for the certificate of " << _certificateName);
+        _state = State::WAIT_CERTIFICATE;
+
+        // the fetcher wakes the waiters even when it fails, this bounds the wait in case it never does
+        _loop.CancelTimer(_timer);
+        _timer = _loop.AddTimer(CERTIFICATE_WAIT_TIMEOUT, [self] {
+            auto connection = self.lock();
+
+            if (connection != nullptr && connection->_state == State::WAIT_CERTIFICATE) {
+                LOG_ERROR("Timeout while waiting for the certificate of " << connection->_certificateName);
+                Metrics::Count(Metrics::Counter::TIMEOUTS);
+                connection->_timer = 0;
+                connection->Close(false);
+            }
+        });
+        return;
+    }
+
+    _isCertificateFetcher = true;
+
+    // the certificate may have been stored since the first lookup, or it may be in the cache directory
+    if ((_certificate = _server.LookupCertificate(_certificateName)) != nullptr) {
+        CompleteCertificateFetch(SingleFlight::Outcome::DONE);
+        ContinueWithCertificate();
+        PreconnectUpstream();
+        return;
+    }
+
+    // known hosts get a certificate of their name right away, the server is only connected for the request
+    if (_server.ShouldMint(_serverName) && (_certificate = _server.MintCertificate(_certificateName)) != nullptr) {
+        CompleteCertificateFetch(SingleFlight::Outcome::DONE);
+        ContinueWithCertificate();
+        PreconnectUpstream();
+        return;
+    }
+
+    // a shared wildcard certificate can not be cloned from the certificate of one of its hosts
+    if (_certificateName != _serverName) {
+        LOG_ERROR("Failed to fetch certificate");
+        CompleteCertificateFetch(SingleFlight::Outcome::FAILED);
+        Close(false);
+        return;
+    }
+
+    // the certificate is generated from the one of the server once the upstream handshake completed
+    _state = State::WAIT_UPSTREAM;
+    StartUpstream();
+}
+
+void ProxyConnection::OnCertificateReady(SingleFlight::Outcome outcome) {
+    if (_state != State::WAIT_CERTIFICATE) {
+        return;
+    }
+
+    _loop.CancelTimer(_timer);
+    _timer = 0;
+
+    // an abandoned fetch is looked up again, this connection may fetch the certificate itself
+    if (outcome == SingleFlight::Outcome::FAILED) {
+        LOG_ERROR("Failed to fetch certificate");
+        Close(false);
+        return;
+    }
+
+    AcquireCertificate();
+    Drive();
+}
+
+void ProxyConnection::CompleteCertificateFetch(SingleFlight::Outcome outcome) {
+    if (_isCertificateFetcher) {
+        _isCertificateFetcher = false;
+        _server.GetCertificateFetches().Complete(_certificateName, outcome);
+    }
+}
+
+void ProxyConnection::ContinueWithCertificate() {
+    if (_certificateStart != std::chrono::steady_clock::time_point()) {
+        Metrics::RecordSince(Metrics::Stage::CERTIFICATE_FETCH, _certificateStart);
+        _certificateStart = std::chrono::steady_clock::time_point();
+    }
+
+    _state = _isHttpConnect ? State::WRITE_CONNECT_REPLY : State::CLIENT_HANDSHAKE;
+}
+
+void ProxyConnection::PreconnectUpstream() {
+    if (_upstreamState == UpstreamState::NONE && _state != State::CLOSED) {
+        LOG_TRACE("Connecting to " << _serverName << " ahead of the request");
+        StartUpstream();
+    }
+}
+
+void ProxyConnection::AwaitUpstream() {
+    _isBackendIdle = _upstreamState == UpstreamState::READY;
+
+    if (_upstreamState == UpstreamState::READY) {
+        StartRelay();
+        return;
+    }
+
+    _state = State::WAIT_UPSTREAM;
+
+    if (_upstreamState == UpstreamState::NONE) {
+        StartUpstream();
+    }
+}
+
+void ProxyConnection::StartUpstream() {
+    std::weak_ptr<ProxyConnection> self = shared_from_this();
+    EventLoop& loop = _loop;
+
+    if ((_backend = _upstreamPool.Acquire(_serverName, _serverPort)) != nullptr) {
+        if (!_loop.Add(_backend->GetSocket(), shared_from_this())) {
+            AbortUpstream();
+            return;
+        }
+
+        // the handshake is already completed, this only moves to the next state
+        Metrics::Count(Metrics::Counter::UPSTREAM_REUSED);
+        _isBackendReused = true;
+        _upstreamState = UpstreamState::HANDSHAKE;
+        return;
+    }
+
+    _isBackendReused = false;
+    _upstreamStart = std::chrono::steady_clock::now();
+
+    auto conf = std::make_unique<SslClientConfig>();
+    conf->isServer = false;
+    conf->localIp = _server.GetConfig().listenIp;
+    conf->serverIp = _serverName;
+    conf->serverPort = _serverPort;
+
+    _client = std::make_shared<SslClient>(std::move(conf));
+    _upstreamState = UpstreamState::RESOLVE;
+
+    // the deadline covers the name resolution too, a resolver which never answers must not stall the connection
+    _upstreamTimer = _loop.AddTimer(UPSTREAM_CONNECT_TIMEOUT, [self] {
+        auto connection = self.lock();
+
+        if (connection != nullptr) {
+            LOG_ERROR("Timeout while connecting to " << connection->_serverName);
+            Metrics::Count(Metrics::Counter::TIMEOUTS);
+            connection->_upstreamTimer = 0;
+            connection->AbortUpstream();
+            connection->Drive();
+        }
+    });
+
+    addresses_t addresses;
+    if (_server.GetResolver().Lookup(_serverName, addresses)) {
+        OnResolved(addresses);
+        return;
+    }
+
+    // name resolution blocks, it runs on the thread pool and continues on the loop once it is done
+    _server.GetResolver().Resolve(_serverName, [self, &loop](const addresses_t& addresses) {
+        loop.Post([self, addresses] {
+            auto connection = self.lock();
+
+            if (connection != nullptr) {
+                connection->OnResolved(addresses);
+                connection->Drive();
+            }
+        });
+    });
+}
+
+void ProxyConnection::OnResolved(const addresses_t& addresses) {
+    std::weak_ptr<ProxyConnection> self = shared_from_this();
+
+    if (_upstreamState != UpstreamState::RESOLVE) {
+        return;
+    }
+
+    if (addresses.empty()) {
+        AbortUpstream();
+        return;
+    }
+
+    // the addresses are raced, the connector calls back from the loop once one of them connected
+    _upstreamState = UpstreamState::CONNECT;
+    _connector = std::make_shared<UpstreamConnector>(_loop, _client, addresses, [self](int32_t socket) {
+        auto connection = self.lock();
+
+        if (connection != nullptr) {
+            connection->OnUpstreamConnected(socket);
+        } else if (socket >= 0) {
+            close(socket);
+        }
+    });
+    _connector->Start();
+}
+
+void ProxyConnection::OnUpstreamConnected(int32_t socket) {
+    _connector = nullptr;
+
+    if (_upstreamState != UpstreamState::CONNECT) {
+        if (socket >= 0) {
+            close(socket);
+        }
+
+        return;
+    }
+
+    if (socket < 0 || (_backend = _client->Connect(socket)) == nullptr ||
+        !_loop.Add(_backend->GetSocket(), shared_from_this())) {
+        AbortUpstream();
+        Drive();
+        return;
+    }
+
+    _upstreamState = UpstreamState::HANDSHAKE;
+    Drive();
+}
+
+bool ProxyConnection::UpstreamHandshake() {
+    switch (_backend->Connect()) {
+    case SslStatus::OK:
+        break;
+    case SslStatus::WANT_IO:
+        return false;
+    default:
+        AbortUpstream();
+        return true;
+    }
+
+    LOG_TRACE("Connected to server " << _serverName);
+
+    if (!_isBackendReused) {
+        Metrics::Count(Metrics::Counter::UPSTREAM_HANDSHAKES);
+        if (SSL_session_reused(_backend->GetSsl())) {
+            Metrics::Count(Metrics::Counter::UPSTREAM_RESUMED);
+        }
+        Metrics::RecordSince(Metrics::Stage::UPSTREAM_CONNECT, _upstreamStart);
+    }
+
+    _loop.CancelTimer(_upstreamTimer);
+    _upstreamTimer = 0;
+    _upstreamState = UpstreamState::READY;
+
+    // connected ahead of the request, it is sent once it was read
+    if (_state != State::WAIT_UPSTREAM) {
+        return true;
+    }
+
+    // connected for a request which is ready to be sent
+    if (_certificate != nullptr) {
+        StartRelay();
+        return true;
+    }
+
+    DEF_X509(serverCertificate, _backend->GetCertificate());
+    _certificate = _server.GenerateCertificate(_serverName, std::move(serverCertificate));
+    CompleteCertificateFetch(_certificate != nullptr ? SingleFlight::Outcome::DONE : SingleFlight::Outcome::FAILED);
+
+    if (_certificate == nullptr) {
+        LOG_ERROR("Failed to fetch certificate");
+        Close(false);
+        return true;
+    }
+
+    ContinueWithCertificate();
+    return true;
+}
+
+bool ProxyConnection::RetryUpstream() {
+    if ((!_isBackendReused && !_isBackendIdle) || !_isRequestReplayable) {
+        return false;
+    }
+
+    LOG_TRACE("Upstream connection to " << _serverName << " was closed, retrying");
+    Metrics::Count(Metrics::Counter::UPSTREAM_RETRIES);
+    _loop.CancelTimer(_timer);
+    _timer = 0;
+    ResetUpstream();
+
+    // send the request again from its start, nothing else was read from the client since
+    _requestPipe.stage = _requestPipe.framer.IsComplete() ? Pipe::Stage::DONE : Pipe::Stage::BODY;
+    _requestPipe.out = _requestReplay;
+    _requestPipe.offset = 0;
+    _responsePipe.stage = Pipe::Stage::HEAD;
+    _responsePipe.parser.Reset();
+    _responsePipe.out.Clear();
+    ReuseBuffer(_responsePipe);
+    _responsePipe.pending.clear();
+
+    AwaitUpstream();
+    return true;
+}
+
+void ProxyConnection::AbortUpstream() {
+    // the request (or the certificate fetch) waits for the upstream connection, it can not go on without it
+    if (_state == State::WAIT_UPSTREAM) {
+        CompleteCertificateFetch(SingleFlight::Outcome::FAILED);
+        Close(false);
+        return;
+    }
+
+    // a connection made ahead of the request, the request connects again once it was read
+    ResetUpstream();
+}
+
+void ProxyConnection::ResetUpstream() {
+    if (_upstreamTimer != 0) {
+        _loop.CancelTimer(_upstreamTimer);
+        _upstreamTimer = 0;
+    }
+
+    if (_connector != nullptr) {
+        _connector->Cancel();
+        _connector = nullptr;
+    }
+
+    if (_backend != nullptr) {
+        _loop.Remove(_backend->GetSocket());
+        _backend->DoClose(false);
+        _backend = nullptr;
+    }
+
+    _upstreamState = UpstreamState::NONE;
+}
+
+bool ProxyConnection::WriteConnectReply() {
+    while (_writeOffset < _connectReply.size()) {
+        ssize_t bytes = write(_frontend->GetSocket(), _connectReply.c_str() + _writeOffset,
+                              _connectReply.size() - _writeOffset);
+
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            }
+
+            Close(false);
+            return true;
+        }
+
+        _writeOffset += bytes;
+    }
+
+    _writeOffset = 0;
+    _state = State::CLIENT_HANDSHAKE;
+    return true;
+}
+
+int32_t ProxyConnection::OnClientHello(const std::string& serverName) {
+    unsigned char context[SHA256_DIGEST_LENGTH];
+
+    if (_certificate != nullptr) {
+        // a session is resumed only for the names of the certificate it was created with, a wildcard certificate
+        // lets the clients resume across all the hosts it covers
+        SHA256(reinterpret_cast<const unsigned char*>(_certificateName.data()), _certificateName.size(), context);
+
+        if (SSL_use_certificate(_frontend->GetSsl(), _certificate) <= 0 ||
+            SSL_set_session_id_context(_frontend->GetSsl(), context, sizeof(context)) <= 0) {
+            LOG_ERROR("Failed to use certificate");
+            return SSL_CLIENT_HELLO_ERROR;
+        }
+
+        return SSL_CLIENT_HELLO_SUCCESS;
+    }
+
+    if (serverName.empty()) {
+        LOG_ERROR("No SNI");
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    LOG_TRACE("Got request with sni: " << serverName);
+    _serverName = serverName;
+    _serverPort = 443;
+    _certificateName = _server.CertificateName(_serverName);
+    _server.GetResolver().Prefetch(_serverName);
+
+    // pause the handshake until the certificate is ready
+    return SSL_CLIENT_HELLO_RETRY;
+}
+
+bool ProxyConnection::ClientHandshake() {
+    switch (_frontend->DoSslConnectAccept()) {
+    case SslStatus::OK:
+        Metrics::RecordSince(Metrics::Stage::CLIENT_HANDSHAKE, _stageStart);
+        Metrics::Count(SSL_session_reused(_frontend->GetSsl()) ? Metrics::Counter::RESUMED_HANDSHAKES
+                                                               : Metrics::Counter::FULL_HANDSHAKES);
+        StartRequest();
+        return true;
+    case SslStatus::WANT_IO:
+        return false;
+    case SslStatus::WANT_CERTIFICATE:
+        AcquireCertificate();
+        return true;
+    default:
+        Close(false);
+        return true;
+    }
+}
+
+void ProxyConnection::StartRequest() {
+    // a pipelined request may already be buffered
+    _requestPipe.stage = Pipe::Stage::HEAD;
+    _requestPipe.parser.Reset();
+    _requestPipe.out.Clear();
+    ReuseBuffer(_requestPipe);
+    _requestPipe.buffer->swap(_requestPipe.pending);
+    _requestPipe.pending.clear();
+    _responsePipe.stage = Pipe::Stage::HEAD;
+    _responsePipe.parser.Reset();
+    _responsePipe.out.Clear();
+    ReuseBuffer(_responsePipe);
+    _responsePipe.pending.clear();
+    _isServerClosed = false;
+    _stageStart = std::chrono::steady_clock::now();
+
+    _state = State::READ_REQUEST_HEAD;
+    RestartReadTimer();
+}
+
+bool ProxyConnection::ReadRequestHead() {
+    size_t before = _requestPipe.buffer->size();
+    SslStatus status = _frontend->DoSslRead(*_requestPipe.buffer, MAX_HEAD_SIZE);
+
+    // the request starts with its first bytes, the connection was idle before
+    if (before == 0 && !_requestPipe.buffer->empty()) {
+        _stageStart = std::chrono::steady_clock::now();
+    }
+
+    if (CompleteHead(_requestPipe, true)) {
+        if (_state == State::CLOSED) {
+            return true;
+        }
+
+        // kept until the server responds, the request is sent again if a reused connection was closed. The replay
+        // shares the buffers of the request
+        _requestReplay = _requestPipe.out;
+        _isRequestReplayable = true;
+
+        AwaitUpstream();
+        return true;
+    }
+
+    if (status == SslStatus::CLOSED || status == SslStatus::ERROR) {
+        Close(status == SslStatus::CLOSED);
+        return true;
+    }
+
+    if (_requestPipe.buffer->size() >= MAX_HEAD_SIZE) {
+        LOG_ERROR("Request headers are too large");
+        Close(false);
+        return true;
+    }
+
+    if (_requestPipe.buffer->size() != before) {
+        RestartReadTimer();
+    }
+
+    return false;
+}
+
+bool ProxyConnection::CompleteHead(Pipe& pipe, bool isRequest) {
+    // only the data which arrived since the last call is scanned
+    HttpParser::Status status = pipe.parser.Parse(pipe.buffer->data(), pipe.buffer->size());
+
+    if (status == HttpParser::Status::INCOMPLETE) {
+        return false;
+    }
+
+    size_t headSize = pipe.parser.HeadSize();
+
+    // framed before the middleware may rewrite the headers
+    if (status == HttpParser::Status::ERROR || pipe.parser.IsRequest() != isRequest ||
+        !pipe.framer.Start(pipe.parser, _requestPipe.framer.IsHeadRequest())) {
+        LOG_ERROR("Invalid HTTP message framing");
+        Close(false);
+        return true;
+    }
+
+    // interim responses usually have no headers at all, they are relayed as is
+    if (pipe.framer.IsInterim()) {
+        pipe.out.Append(pipe.buffer, 0, headSize);
+    } else if (!RunMiddleware(pipe, isRequest, headSize)) {
+        Close(true);
+        return true;
+    }
+
+    pipe.offset = 0;
+    pipe.stage = Pipe::Stage::BODY;
+    ConsumeBody(pipe, headSize);
+
+    // the rest of the client data goes as is to the server after the connection was upgraded
+    if (!isRequest && pipe.framer.IsUpgrade()) {
+        _requestPipe.framer.StartTunnel();
+        _requestPipe.stage = Pipe::Stage::BODY;
+
+        // the data is appended after the bytes already queued, those are not changed
+        size_t offset = _requestPipe.buffer->size();
+        _requestPipe.buffer->append(_requestPipe.pending);
+        _requestPipe.pending.clear();
+        ConsumeBody(_requestPipe, offset);
+    }
+
+    return true;
+}
+
+void ProxyConnection::ConsumeBody(Pipe& pipe, size_t offset) {
+    std::string& buffer = *pipe.buffer;
+    size_t bytes = pipe.framer.Consume(buffer.data() + offset, buffer.size() - offset);
+
+    // anything past the end of the message belongs to the next one
+    if (offset + bytes < buffer.size()) {
+        pipe.pending.append(buffer, offset + bytes, std::string::npos);
+        buffer.resize(offset + bytes);
+    }
+
+    // the body skips the middleware unless one of its layers needs it
+    if (!_middleware.NeedsBody()) {
+        pipe.out.Append(pipe.buffer, offset, bytes);
+    } else if (bytes > 0 && !RunBodyMiddleware(pipe, offset, bytes)) {
+        Close(true);
+        return;
+    }
+
+    if (_access.startTime != 0) {
+        (&pipe == &_requestPipe ? _access.requestBodySize : _access.responseBodySize) += bytes;
+    }
+
+    if (pipe.framer.IsComplete()) {
+        pipe.stage = Pipe::Stage::DONE;
+    }
+}
+
+void ProxyConnection::ReuseBuffer(Pipe& pipe) {
+    if (pipe.buffer.use_count() > 1) {
+        pipe.buffer = std::make_shared<std::string>();
+    } else {
+        pipe.buffer->clear();
+    }
+}
+
+void ProxyConnection::StartRelay() {
+    // the upstream connection is ready, the request is sent from now on
+    _access.upstreamTime = _access.startTime != 0 ? MicrosecondsSince(_exchangeStart) : 0;
+    _state = State::RELAY;
+    RestartReadTimer();
+}
+
+bool ProxyConnection::Relay() {
+    bool progress = false;
+
+    RelayRequest(progress);
+
+    if (_state == State::RELAY) {
+        RelayResponse(progress);
+    }
+
+    if (progress && _state == State::RELAY) {
+        RestartReadTimer();
+    }
+
+    return progress || _state != State::RELAY;
+}
+
+void ProxyConnection::RelayRequest(bool& progress) {
+    size_t before = _requestPipe.offset;
+    SslStatus status = _backend->DoSslWrite(_requestPipe.out, _requestPipe.offset);
+
+    progress = progress || _requestPipe.offset != before;
+
+    if (status == SslStatus::WANT_IO) {
+        return;
+    } else if (status != SslStatus::OK) {
+        if (!RetryUpstream()) {
+            Close(false);
+        }
+
+        return;
+    }
+
+    _requestPipe.out.Clear();
+    _requestPipe.offset = 0;
+
+    if (_requestPipe.stage != Pipe::Stage::BODY) {
+        return;
+    }
+
+    ReuseBuffer(_requestPipe);
+    status = _frontend->DoSslRead(*_requestPipe.buffer, PIPE_BUFFER_SIZE);
+
+    if (!_requestPipe.buffer->empty()) {
+        progress = true;
+        _isRequestReplayable = false;
+        _requestReplay.Clear();
+        ConsumeBody(_requestPipe, 0);
+    }
+
+    if (_requestPipe.framer.HasError()) {
+        LOG_ERROR("Invalid HTTP request body");
+        Close(false);
+    } else if (status == SslStatus::CLOSED || status == SslStatus::ERROR) {
+        Close(status == SslStatus::CLOSED);
+    }
+}
+
+void ProxyConnection::RelayResponse(bool& progress) {
+    if (_responsePipe.stage == Pipe::Stage::HEAD && !ReadResponseHead(progress)) {
+        return;
+    }
+
+    size_t before = _responsePipe.offset;
+    SslStatus status = _frontend->DoSslWrite(_responsePipe.out, _responsePipe.offset);
+
+    progress = progress || _responsePipe.offset != before;
+
+    if (status == SslStatus::WANT_IO) {
+        return;
+    } else if (status != SslStatus::OK) {
+        Close(false);
+        return;
+    }
+
+    _responsePipe.out.Clear();
+    _responsePipe.offset = 0;
+
+    if (_responsePipe.stage == Pipe::Stage::DONE && _responsePipe.framer.IsInterim()) {
+        // the final response follows the interim one
+        _responsePipe.stage = Pipe::Stage::HEAD;
+        _responsePipe.parser.Reset();
+        ReuseBuffer(_responsePipe);
+        _responsePipe.buffer->swap(_responsePipe.pending);
+        _responsePipe.pending.clear();
+        progress = true;
+        return;
+    } else if (_responsePipe.stage == Pipe::Stage::DONE || _isServerClosed) {
+        FinishExchange(_responsePipe.stage == Pipe::Stage::DONE && !_isServerClosed);
+        progress = true;
+        return;
+    }
+
+    ReuseBuffer(_responsePipe);
+    status = _backend->DoSslRead(*_responsePipe.buffer, PIPE_BUFFER_SIZE);
+
+    if (!_responsePipe.buffer->empty()) {
+        progress = true;
+        ConsumeBody(_responsePipe, 0);
+    }
+
+    if (_responsePipe.framer.HasError()) {
+        LOG_ERROR("Invalid HTTP response body");
+        Close(false);
+    } else if (status == SslStatus::CLOSED || status == SslStatus::ERROR) {
+        // the end of a close delimited response, otherwise the response is truncated
+        _isServerClosed = true;
+        progress = true;
+    }
+}
+
+bool ProxyConnection::ReadResponseHead(bool& progress) {
+    size_t before = _responsePipe.buffer->size();
+    SslStatus status = _backend->DoSslRead(*_responsePipe.buffer, MAX_HEAD_SIZE);
+
+    progress = progress || _responsePipe.buffer->size() != before;
+
+    if (CompleteHead(_responsePipe, false)) {
+        return _state == State::RELAY;
+    }
+
+    if (status == SslStatus::CLOSED || status == SslStatus::ERROR) {
+        if (_responsePipe.buffer->empty()) {
+            if (!RetryUpstream()) {
+                Close(false);
+            }
+
+            progress = true;
+            return false;
+        }
+
+        // not an HTTP response, relay it as is
+        _responsePipe.stage = Pipe::Stage::BODY;
+        _responsePipe.out.Append(_responsePipe.buffer, 0, _responsePipe.buffer->size());
+        _isServerClosed = true;
+        return true;
+    }
+
+    if (_responsePipe.buffer->size() >= MAX_HEAD_SIZE) {
+        LOG_ERROR("Response headers are too large");
+        Close(false);
+    }
+
+    return false;
+}
+
+void ProxyConnection::FinishExchange(bool complete) {
+    // the connections are reused only if both messages were complete and allow it, and the server did not send
+    // anything past the response
+    bool isRequestComplete = _requestPipe.stage == Pipe::Stage::DONE && _requestPipe.out.Empty();
+    bool isServerKeepAlive = complete && isRequestComplete && _responsePipe.framer.IsKeepAlive() &&
+                             _responsePipe.pending.empty();
+    bool isClientKeepAlive = complete && isRequestComplete && _requestPipe.framer.IsKeepAlive() &&
+                             _responsePipe.framer.IsKeepAlive();
+
+    _loop.Remove(_backend->GetSocket());
+
+    if (isServerKeepAlive) {
+        _upstreamPool.Release(_serverName, _serverPort, std::move(_backend));
+    } else {
+        _backend->DoClose(true);
+    }
+
+    // the server may close the connection right after a complete response
+    EndExchange(_responsePipe.stage == Pipe::Stage::DONE);
+    _backend = nullptr;
+    _upstreamState = UpstreamState::NONE;
+    _requestReplay.Clear();
+
+    if (!isClientKeepAlive) {
+        Close(true);
+        return;
+    }
+
+    // wait for the next request on the same connection
+    StartRequest();
+}
+
+void ProxyConnection::RestartReadTimer() {
+    std::weak_ptr<ProxyConnection> self = shared_from_this();
+
+    // the client connection is idle until a request starts, during the exchange both sides should make progress
+    auto timeout = _state == State::READ_REQUEST_HEAD ? _server.GetConfig().clientIdleTimeout : RELAY_TIMEOUT;
+
+    _loop.CancelTimer(_timer);
+    _timer = _loop.AddTimer(timeout, [self] {
+        auto connection = self.lock();
+
+        if (connection != nullptr) {
+            connection->_timer = 0;
+            connection->OnReadIdle();
+        }
+    });
+}
+
+void ProxyConnection::OnReadIdle() {
+    if (_state == State::READ_REQUEST_HEAD) {
+        LOG_TRACE("Client connection is idle");
+        Close(true);
+    } else if (_state == State::RELAY) {
+        LOG_ERROR("Timeout while relaying to " << _serverName);
+        Metrics::Count(Metrics::Counter::TIMEOUTS);
+        Close(false);
+    }
+}
+
+bool ProxyConnection::RunMiddleware(Pipe& pipe, bool isRequest, size_t headSize) {
+    pipe.messageId = ++_lastMessageId;
+    Message msg(MessageTypes::HTTP_HEAD, pipe.messageId);
+
+    try {
+        // the layers get the head as parsed by the pipe parser, it is not parsed again nor copied
+        msg.Data.Append(pipe.buffer, 0, headSize);
+        msg.Head = std::make_unique<HttpHead>(pipe.buffer, headSize, pipe.parser);
+        msg = isRequest ? _middleware.ProcessRequest(std::move(msg)) : _middleware.ProcessResponse(std::move(msg));
+    } catch (std::invalid_argument* e) {
+        LOG_ERROR(e->what());
+        return false;
+    } catch (const std::exception& e) {
+        LOG_ERROR(e.what());
+        return false;
+    }
+
+    switch (msg.Type()) {
+    case MessageTypes::HTTP_HEAD:
+        break;
+    case MessageTypes::ERROR:
+        LOG_ERROR(msg.ErrorString);
+        return false;
+    default:
+        LOG_ERROR("Message should be of type HttpHead, got " << msg.ToString());
+        return false;
+    }
+
+    // after the middleware, which could have added it back
+    if (pipe.framer.IsLengthOverridden()) {
+        msg.Head->Edits.Remove(HttpHeaders::NameOf(HttpHeaderId::CONTENT_LENGTH));
+    }
+
+    RecordHead(msg.Head->Http, pipe.parser, isRequest, headSize);
+
+    // an unchanged head is relayed from the buffer as is, otherwise the changed lines are spliced in
+    pipe.out.Append(msg.Head->Edits.Empty() ? msg.Data : msg.Head->Edits.ToChain());
+    return true;
+}
+
+bool ProxyConnection::RunBodyMiddleware(Pipe& pipe, size_t offset, size_t size) {
+    Message msg(MessageTypes::HTTP_BODY, pipe.messageId);
+
+    msg.Data.Append(pipe.buffer, offset, size);
+    msg = &pipe == &_requestPipe ? _middleware.ProcessRequest(std::move(msg))
+                                 : _middleware.ProcessResponse(std::move(msg));
+
+    if (msg.Type() != MessageTypes::HTTP_BODY) {
+        LOG_ERROR((msg.Type() == MessageTypes::ERROR ? msg.ErrorString : "Message should be of type HttpBody"));
+        return false;
+    }
+
+    pipe.out.Append(msg.Data);
+    return true;
+}
+
+void ProxyConnection::RecordHead(const HttpMessage& head, const HttpParser& parser, bool isRequest,
+                                 size_t headSize) {
+    if (!isRequest) {
+        _access.waitTime = MicrosecondsSince(_exchangeStart) - _access.upstreamTime;
+        _access.responseHeadSize = headSize;
+
+        _access.statusCode = parser.StatusCodeValue();
+
+        return;
+    }
+
+    _exchangeStart = Metrics::RecordSince(Metrics::Stage::REQUEST_HEAD, _stageStart);
+    _access.startTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    _access.connectionId = _id;
+    _access.exchange = ++_exchanges;
+    _access.requestHeadSize = headSize;
+    _access.port = _serverPort;
+    _access.method = static_cast<uint8_t>(head.Method());
+
+    if (AccessLog::IsEnabled()) {
+        _accessPath = head.Path();
+    }
+}
+
+void ProxyConnection::EndExchange(bool complete) {
+    if (_access.startTime == 0) {
+        return;
+    }
+
+    _access.totalTime = MicrosecondsSince(_exchangeStart);
+    Metrics::Count(complete ? Metrics::Counter::EXCHANGES : Metrics::Counter::INCOMPLETE_EXCHANGES);
+    Metrics::Record(Metrics::Stage::EXCHANGE, std::chrono::microseconds(_access.totalTime));
+
+    if (_access.statusCode != 0) {
+        _access.transferTime = _access.totalTime - _access.upstreamTime - _access.waitTime;
+        Metrics::Record(Metrics::Stage::UPSTREAM_RESPONSE, std::chrono::microseconds(_access.waitTime));
+        Metrics::Record(Metrics::Stage::RESPONSE_TRANSFER, std::chrono::microseconds(_access.transferTime));
+    }
+
+    if (AccessLog::IsEnabled()) {
+        _access.flags = (complete ? ACCESS_COMPLETE : 0) | (_isBackendReused ? ACCESS_UPSTREAM_REUSED : 0);
+        AccessLog::Write(_access, _serverName, _accessPath);
+    }
+
+    _access = AccessRecord();
+}
+
+void ProxyConnection::Close(bool shutdown) {
+    if (_state == State::CLOSED) {
+        return;
+    }
+
+    _state = State::CLOSED;
+    Metrics::Count(Metrics::Counter::CLOSED_CONNECTIONS);
+    EndExchange(false);
+
+    // the connection closed before the certificate was fetched (e.g. the client went away), the connections
+    // waiting for it look it up again
+    CompleteCertificateFetch(SingleFlight::Outcome::ABANDONED);
+
+    if (_timer != 0) {
+        _loop.CancelTimer(_timer);
+        _timer = 0;
+    }
+
+    if (_frontend != nullptr) {
+        if (_frontend->GetSsl() != nullptr) {
+            SSL_set_ex_data(_frontend->GetSsl(), 0, nullptr);
+        }
+
+        _loop.Remove(_frontend->GetSocket());
+        _frontend->DoClose(shutdown);
+    }
+
+    if (_upstreamTimer != 0) {
+        _loop.CancelTimer(_upstreamTimer);
+        _upstreamTimer = 0;
+    }
+
+    if (_connector != nullptr) {
+        _connector->Cancel();
+        _connector = nullptr;
+    }
+
+    if (_backend != nullptr) {
+        _loop.Remove(_backend->GetSocket());
+        _backend->DoClose(shutdown);
+    }
+}
@@ -0,0 +1,212 @@
+#include "core/UpstreamConnector.h"
+#include "ssl/SslClient.h"
+#include "utils/Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+
+constexpr std::chrono::milliseconds UpstreamConnector::ATTEMPT_DELAY;
+
+// the address which won the last race of every origin (host:port)
+constexpr size_t MAX_ORIGINS = 10000;
+
+static std::mutex winnersLock;
+static std::unordered_map<std::string, struct sockaddr_storage> winners;
+
+static bool IsSameAddress(const struct sockaddr_storage& x, const struct sockaddr_storage& y) {
+    if (x.ss_family != y.ss_family) {
+        return false;
+    }
+
+    if (x.ss_family == AF_INET) {
+        return reinterpret_cast<const struct sockaddr_in&>(x).sin_addr.s_addr ==
+               reinterpret_cast<const struct sockaddr_in&>(y).sin_addr.s_addr;
+    }
+
+    return memcmp(&reinterpret_cast<const struct sockaddr_in6&>(x).sin6_addr,
+                  &reinterpret_cast<const struct sockaddr_in6&>(y).sin6_addr, sizeof(struct in6_addr)) == 0;
+}
+
+UpstreamConnector::UpstreamConnector(EventLoop& loop, std::shared_ptr<SslClient> client, const addresses_t& addresses,
+                                     callback_t callback)
+    : _loop(loop), _client(std::move(client)), _origin(), _addresses(), _next(0), _attempts(), _timer(0),
+      _callback(std::move(callback)) {
+    const SslClientConfig& config = _client->GetConfig();
+    addresses_t v6, v4;
+    struct sockaddr_storage winner;
+    bool hasWinner = false;
+
+    _origin = config.serverIp + ":" + std::to_string(config.serverPort);
+
+    {
+        std::lock_guard<std::mutex> guard(winnersLock);
+        auto it = winners.find(_origin);
+
+        if (it != winners.end()) {
+            winner = it->second;
+            hasWinner = true;
+        }
+    }
+
+    for (auto address : addresses) {
+        if (address.ss_family == AF_INET) {
+            reinterpret_cast<struct sockaddr_in&>(address).sin_port = htons(config.serverPort);
+        } else if (address.ss_family == AF_INET6) {
+            reinterpret_cast<struct sockaddr_in6&>(address).sin6_port = htons(config.serverPort);
+        } else {
+            continue;
+        }
+
+        if (hasWinner && IsSameAddress(address, winner)) {
+            _addresses.push_back(address);
+        } else {
+            (address.ss_family == AF_INET6 ? v6 : v4).push_back(address);
+        }
+    }
+
+    // alternate the families so a broken one costs a single attempt delay
+    for (size_t i = 0; i < std::max(v6.size(), v4.size()); i++) {
+        if (i < v6.size()) {
+            _addresses.push_back(v6[i]);
+        }
+
+        if (i < v4.size()) {
+            _addresses.push_back(v4[i]);
+        }
+    }
+}
+
+void UpstreamConnector::Start() {
+    // the callback may release the connector
+    auto self = shared_from_this();
+
+    if (!StartNext()) {
+        Finish(-1, nullptr);
+    }
+}
+
+void UpstreamConnector::Cancel() {
+    if (_timer != 0) {
+        _loop.CancelTimer(_timer);
+        _timer = 0;
+    }
+
+    for (auto& attempt : _attempts) {
+        _loop.Remove(attempt.first);
+        close(attempt.first);
+    }
+
+    _attempts.clear();
+    _callback = nullptr;
+}
+
+bool UpstreamConnector::StartNext() {
+    std::weak_ptr<UpstreamConnector> self = shared_from_this();
+
+    if (_timer != 0) {
+        _loop.CancelTimer(_timer);
+        _timer = 0;
+    }
+
+    while (_next < _addresses.size()) {
+        size_t index = _next++;
+        int32_t s = _client->CreateSocket(_addresses[index]);
+
+        if (s < 0) {
+            continue;
+        }
+
+        if (!_loop.Add(s, shared_from_this())) {
+            close(s);
+            continue;
+        }
+
+        _attempts.emplace_back(s, index);
+
+        if (_next < _addresses.size()) {
+            _timer = _loop.AddTimer(ATTEMPT_DELAY, [self] {
+                auto connector = self.lock();
+
+                if (connector != nullptr) {
+                    connector->_timer = 0;
+
+                    if (!connector->StartNext()) {
+                        connector->Finish(-1, nullptr);
+                    }
+                }
+            });
+        }
+
+        return true;
+    }
+
+    return !_attempts.empty();
+}
+
+void UpstreamConnector::OnEvent(int32_t fd, uint32_t events) {
+    struct sockaddr_storage peer;
+    socklen_t len = sizeof(peer);
+    int32_t error = 0;
+    socklen_t errorLen = sizeof(error);
+
+    auto it = std::find_if(_attempts.begin(), _attempts.end(),
+                           [fd](const std::pair<int32_t, size_t>& attempt) { return attempt.first == fd; });
+
+    if (it == _attempts.end()) {
+        return;
+    }
+
+    // getpeername() only succeeds once the connection is established
+    if (getpeername(fd, reinterpret_cast<struct sockaddr*>(&peer), &len) == 0) {
+        size_t index = it->second;
+
+        _attempts.erase(it);
+        _loop.Remove(fd);
+        Finish(fd, &_addresses[index]);
+        return;
+    }
+
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) == 0 && error == 0) {
+        return; // still connecting
+    }
+
+    LOG_TRACE("Unable to connect to " << _origin << " (" << std::strerror(error != 0 ? error : errno) << ")");
+    _attempts.erase(it);
+    _loop.Remove(fd);
+    close(fd);
+
+    // the next address does not wait for the delay once all the running attempts failed
+    if (_attempts.empty() && !StartNext()) {
+        Finish(-1, nullptr);
+    }
+}
+
+void UpstreamConnector::Finish(int32_t socket, const struct sockaddr_storage* address) {
+    callback_t callback = std::move(_callback);
+
+    if (address != nullptr) {
+        std::lock_guard<std::mutex> guard(winnersLock);
+
+        if (winners.size() >= MAX_ORIGINS && winners.find(_origin) == winners.end()) {
+            winners.erase(winners.begin());
+        }
+
+        winners[_origin] = *address;
+    } else {
+        LOG_ERROR("Unable to connect to " << _origin);
+    }
+
+    Cancel();
+
+    if (callback != nullptr) {
+        callback(socket);
+    } else if (socket >= 0) {
+        close(socket);
+    }
+}
@@ -0,0 +1,105 @@
+#include <cerrno>
+#include <sys/socket.h>
+
+#include "core/UpstreamPool.h"
+#include "utils/Logger.h"
+
+// Return true if the server did not close the idle connection or wrote to it
+static bool IsAlive(int32_t socket) {
+    char c = 0;
+    ssize_t bytes = recv(socket, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT);
+
+    return bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+UpstreamPool::UpstreamPool(EventLoop& loop, const UpstreamPoolConfig& config)
+    : _loop(loop), _config(config), _idle(), _sockets() {}
+
+std::unique_ptr<BackendSslLayer> UpstreamPool::Acquire(const std::string& host, int32_t port) {
+    auto it = _idle.find(host + ":" + std::to_string(port));
+
+    while (it != _idle.end() && !it->second.empty()) {
+        IdleConnection idle = std::move(it->second.back());
+        int32_t socket = idle.backend->GetSocket();
+
+        it->second.pop_back();
+        _sockets.erase(socket);
+        _loop.CancelTimer(idle.timer);
+        _loop.Remove(socket);
+
+        if (IsAlive(socket)) {
+            LOG_TRACE("Reuse upstream connection " << socket << " to " << host << ":" << port);
+            return std::move(idle.backend);
+        }
+
+        idle.backend->DoClose(false);
+    }
+
+    return nullptr;
+}
+
+void UpstreamPool::Release(const std::string& host, int32_t port, std::unique_ptr<BackendSslLayer> backend) {
+    std::weak_ptr<UpstreamPool> self = shared_from_this();
+    std::string key = host + ":" + std::to_string(port);
+    int32_t socket = backend->GetSocket();
+
+    if (_sockets.size() >= _config.maxIdle || _config.maxIdlePerHost == 0 || !IsAlive(socket)) {
+        backend->DoClose(true);
+        return;
+    }
+
+    // make room by closing the connection which is idle for the longest time
+    auto it = _idle.find(key);
+    if (it != _idle.end() && it->second.size() >= _config.maxIdlePerHost) {
+        Drop(it->second.front().backend->GetSocket(), true);
+    }
+
+    idle_list_t& idle = _idle[key];
+
+    if (!_loop.Add(socket, shared_from_this())) {
+        backend->DoClose(false);
+        return;
+    }
+
+    uint64_t timer = _loop.AddTimer(_config.idleTimeout, [self, socket] {
+        auto pool = self.lock();
+
+        if (pool != nullptr) {
+            pool->Drop(socket, true);
+        }
+    });
+
+    idle.push_back(IdleConnection{std::move(backend), timer});
+    _sockets[socket] = std::make_pair(key, std::prev(idle.end()));
+
+    LOG_TRACE("Keep upstream connection " << socket << " to " << key);
+}
+
+void UpstreamPool::OnEvent(int32_t fd, uint32_t events) {
+    // an idle connection is only writable, anything else means the server closed it
+    if (_sockets.find(fd) != _sockets.end() && !IsAlive(fd)) {
+        Drop(fd, false);
+    }
+}
+
+void UpstreamPool::Drop(int32_t fd, bool shutdown) {
+    auto it = _sockets.find(fd);
+
+    if (it == _sockets.end()) {
+        return;
+    }
+
+    auto host = _idle.find(it->second.first);
+    std::unique_ptr<BackendSslLayer> backend = std::move(it->second.second->backend);
+
+    _loop.CancelTimer(it->second.second->timer);
+    host->second.erase(it->second.second);
+    _sockets.erase(it);
+
+    if (host->second.empty()) {
+        _idle.erase(host);
+    }
+
+    _loop.Remove(fd);
+    backend->DoClose(shutdown);
+}
@@ -0,0 +1,336 @@
+#include "http/HttpFramer.h"
+#include "http/HttpHeaders.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// Chunk size and trailer lines longer than this are rejected
+static constexpr size_t MAX_LINE_SIZE = 8192;
+
+// Return true if token appears in a comma separated list, case insensitive
+static bool HasToken(StringView list, StringView token) {
+    size_t start = 0;
+
+    while (start <= list.size()) {
+        size_t end = min(list.find(',', start), list.size());
+
+        if (list.substr(start, end - start).Trim().EqualsIgnoreCase(token)) {
+            return true;
+        }
+
+        start = end + 1;
+    }
+
+    return false;
+}
+
+// Parse a non negative decimal number, returns false if s is not a valid number or does not fit in value
+static bool ParseLength(StringView s, uint64_t& value) {
+    // header bytes may be negative as char, the ctype functions are undefined for those
+    if (s.empty() || !all_of(s.begin(), s.end(), [](unsigned char c) { return isdigit(c); })) {
+        return false;
+    }
+
+    value = 0;
+    for (char c : s) {
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+
+        value = value * 10 + digit;
+    }
+
+    return true;
+}
+
+// tchar of RFC 7230 section 3.2.6
+static bool IsTokenChar(unsigned char c) { return isalnum(c) || (c != 0 && strchr("!#$%&'*+-.^_`|~", c) != nullptr); }
+
+static void SkipWhitespace(StringView s, size_t& i) {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) {
+        i++;
+    }
+}
+
+// Skip a token, returns false if there is none at i
+static bool SkipToken(StringView s, size_t& i) {
+    size_t start = i;
+
+    while (i < s.size() && IsTokenChar(s[i])) {
+        i++;
+    }
+
+    return i > start;
+}
+
+// Skip a quoted-string, returns false if there is none at i. Any byte but the controls can be quoted
+static bool SkipQuotedString(StringView s, size_t& i) {
+    if (i == s.size() || s[i] != '"') {
+        return false;
+    }
+
+    for (i++; i < s.size() && s[i] != '"'; i++) {
+        if (s[i] == '\\' && i + 1 < s.size()) {
+            i++;
+        }
+
+        unsigned char c = s[i];
+        if ((c < 0x20 && c != '\t') || c == 0x7f) {
+            return false;
+        }
+    }
+
+    return i++ < s.size();
+}
+
+// Parse chunk-size [ chunk-ext ] (RFC 7230 section 4.1), where
+//   chunk-ext = *( BWS ";" BWS chunk-ext-name [ BWS "=" BWS ( token / quoted-string ) ] )
+// A line with anything else is rejected, the peer could find another chunk size in it
+static bool ParseChunkSizeLine(StringView line, uint64_t& size) {
+    size_t i = 0;
+
+    while (i < line.size() && isxdigit(static_cast<unsigned char>(line[i]))) {
+        i++;
+    }
+
+    if (i == 0 || i > 15) {
+        return false;
+    }
+
+    size = strtoull(line.substr(0, i).ToString().c_str(), nullptr, 16);
+
+    while (i < line.size()) {
+        SkipWhitespace(line, i);
+        if (i == line.size() || line[i++] != ';') {
+            return false;
+        }
+
+        SkipWhitespace(line, i);
+        if (!SkipToken(line, i)) {
+            return false;
+        }
+
+        SkipWhitespace(line, i);
+        if (i == line.size() || line[i] == ';') {
+            continue;
+        } else if (line[i++] != '=') {
+            return false;
+        }
+
+        SkipWhitespace(line, i);
+        if (!SkipToken(line, i) && !SkipQuotedString(line, i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+HttpFramer::HttpFramer()
+    : _bodyType(BodyType::NONE), _state(State::DONE), _remaining(0), _line(""), _isKeepAlive(false),
+      _isHeadRequest(false), _isInterim(false), _isUpgrade(false), _isLengthOverridden(false) {}
+
+bool HttpFramer::ParseHead(const HttpParser& head, int32_t& status, bool& isChunked, bool& hasContentLength) {
+    bool hasClose = false, hasKeepAlive = false, hasTransferEncoding = false;
+
+    if (head.IsRequest()) {
+        _isHeadRequest = head.Method() == "HEAD";
+    } else {
+        status = head.StatusCodeValue();
+    }
+
+    for (size_t i = 0; i < head.HeadersCount(); i++) {
+        HttpParser::Header header = head.GetHeader(i);
+        uint64_t length = 0;
+        size_t lastComma = 0;
+
+        switch (HttpHeaders::IdOf(header.name)) {
+        case HttpHeaderId::CONNECTION:
+            hasClose = hasClose || HasToken(header.value, "close");
+            hasKeepAlive = hasKeepAlive || HasToken(header.value, "keep-alive");
+            break;
+        case HttpHeaderId::TRANSFER_ENCODING:
+            // chunked must be the last coding applied
+            hasTransferEncoding = true;
+            lastComma = header.value.rfind(',');
+            isChunked = header.value.substr(lastComma == StringView::npos ? 0 : lastComma + 1)
+                            .Trim()
+                            .EqualsIgnoreCase("chunked");
+            break;
+        case HttpHeaderId::CONTENT_LENGTH:
+            // repeated Content-Length headers must agree
+            if (!ParseLength(header.value, length) || (hasContentLength && length != _remaining)) {
+                return false;
+            }
+
+            hasContentLength = true;
+            _remaining = length;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // a request with a transfer coding other than chunked can not be framed
+    if (head.IsRequest() && hasTransferEncoding && !isChunked) {
+        return false;
+    }
+
+    // Transfer-Encoding overrides Content-Length
+    _isLengthOverridden = hasContentLength && hasTransferEncoding;
+    hasContentLength = hasContentLength && !hasTransferEncoding;
+
+    _isKeepAlive = !hasClose && (head.Version() == "HTTP/1.1" || hasKeepAlive);
+    return head.Version().StartsWith("HTTP/");
+}
+
+bool HttpFramer::Start(const HttpParser& head, bool isHeadRequest) {
+    int32_t status = 0;
+    bool isChunked = false, hasContentLength = false;
+    bool isRequest = head.IsRequest();
+
+    _bodyType = BodyType::NONE;
+    _state = State::DONE;
+    _remaining = 0;
+    _line.clear();
+    _isKeepAlive = false;
+    _isHeadRequest = false;
+    _isInterim = false;
+    _isUpgrade = false;
+    _isLengthOverridden = false;
+
+    if (head.GetStatus() != HttpParser::Status::DONE || !ParseHead(head, status, isChunked, hasContentLength)) {
+        _state = State::ERROR;
+        return false;
+    }
+
+    if (!isRequest) {
+        _isUpgrade = status == 101;
+        _isInterim = status >= 100 && status < 200 && !_isUpgrade;
+
+        if (_isUpgrade) {
+            StartTunnel();
+            return true;
+        } else if (isHeadRequest || _isInterim || status == 204 || status == 304) {
+            return true;
+        }
+    }
+
+    if (isChunked) {
+        _bodyType = BodyType::CHUNKED;
+        _state = State::CHUNK_SIZE;
+    } else if (hasContentLength) {
+        _bodyType = BodyType::LENGTH;
+        _state = _remaining > 0 ? State::BODY : State::DONE;
+    } else if (!isRequest) {
+        _bodyType = BodyType::CLOSE;
+        _state = State::BODY;
+        _isKeepAlive = false;
+    }
+
+    return true;
+}
+
+void HttpFramer::StartTunnel() {
+    _bodyType = BodyType::CLOSE;
+    _state = State::BODY;
+    _isKeepAlive = false;
+}
+
+void HttpFramer::OnChunkSizeLine() {
+    // chunk-size [ chunk-ext ] CRLF, a bare LF is accepted too
+    StringView line(_line);
+
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+        line = line.substr(0, line.size() - 1);
+    }
+
+    if (!ParseChunkSizeLine(line, _remaining)) {
+        _line.clear();
+        _state = State::ERROR;
+        return;
+    }
+
+    _line.clear();
+    _state = _remaining > 0 ? State::CHUNK_DATA : State::TRAILER;
+}
+
+void HttpFramer::OnTrailerLine() {
+    // the trailer ends with an empty line
+    bool isEmpty = _line.empty() || _line == "\r";
+
+    _line.clear();
+
+    if (isEmpty) {
+        _state = State::DONE;
+    }
+}
+
+size_t HttpFramer::Consume(const char* data, size_t size) {
+    size_t offset = 0;
+
+    while (offset < size && _state != State::DONE && _state != State::ERROR) {
+        size_t bytes = 0;
+
+        switch (_state) {
+        case State::BODY:
+            if (_bodyType == BodyType::CLOSE) {
+                return size;
+            }
+
+            bytes = static_cast<size_t>(min<uint64_t>(_remaining, size - offset));
+            offset += bytes;
+            _remaining -= bytes;
+            _state = _remaining > 0 ? State::BODY : State::DONE;
+            break;
+        case State::CHUNK_DATA:
+            bytes = static_cast<size_t>(min<uint64_t>(_remaining, size - offset));
+            offset += bytes;
+            _remaining -= bytes;
+            _state = _remaining > 0 ? State::CHUNK_DATA : State::CHUNK_END;
+            break;
+        case State::CHUNK_END:
+            // CRLF (or a bare LF) after the chunk data, anything else would be framed differently by the peer
+            if (data[offset] == '\r') {
+                _state = State::CHUNK_END_LF;
+            } else {
+                _state = data[offset] == '\n' ? State::CHUNK_SIZE : State::ERROR;
+            }
+
+            offset++;
+            break;
+        case State::CHUNK_END_LF:
+            _state = data[offset++] == '\n' ? State::CHUNK_SIZE : State::ERROR;
+            break;
+        case State::CHUNK_SIZE:
+        case State::TRAILER: {
+            auto lineEnd = static_cast<const char*>(memchr(data + offset, '\n', size - offset));
+            bytes = (lineEnd == nullptr ? size : lineEnd - data) - offset;
+
+            if (_line.size() + bytes > MAX_LINE_SIZE) {
+                _state = State::ERROR;
+                break;
+            }
+
+            _line.append(data + offset, bytes);
+            offset += bytes;
+
+            if (lineEnd != nullptr) {
+                offset++;
+                _state == State::CHUNK_SIZE ? OnChunkSizeLine() : OnTrailerLine();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    return offset;
+}
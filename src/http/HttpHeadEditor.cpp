@@ -0,0 +1,157 @@
+#include "http/HttpHeadEditor.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+HttpHeadEditor::HttpHeadEditor(const HttpMessage& message) : _message(message), _edits(), _appended() {}
+
+string HttpHeadEditor::MakeLine(StringView name, StringView value) {
+    string line;
+
+    line.reserve(name.size() + value.size() + 4);
+    line.append(name.data(), name.size()).append(": ").append(value.data(), value.size()).append("\r\n");
+
+    return line;
+}
+
+HttpHeadEditor::Edit* HttpHeadEditor::FindEdit(size_t index) {
+    auto edit = find_if(_edits.begin(), _edits.end(), [index](const Edit& edit) { return edit.index == index; });
+    return edit == _edits.end() ? nullptr : &*edit;
+}
+
+const HttpHeadEditor::Edit* HttpHeadEditor::FindEdit(size_t index) const {
+    return const_cast<HttpHeadEditor*>(this)->FindEdit(index);
+}
+
+void HttpHeadEditor::EditLine(size_t index, string line) {
+    Edit* edit = FindEdit(index);
+
+    if (edit == nullptr) {
+        _edits.push_back(Edit{index, std::move(line)});
+    } else {
+        edit->line = std::move(line);
+    }
+}
+
+void HttpHeadEditor::Set(StringView name, StringView value) {
+    const HttpHeaders& headers = _message.Headers();
+    bool isSet = false;
+
+    for (size_t i = headers.Find(name); i != HttpHeaders::npos; i = headers.Find(name, i + 1)) {
+        const Edit* edit = FindEdit(i);
+
+        if (edit != nullptr && edit->line.empty()) {
+            continue; // already removed
+        } else if (isSet) {
+            EditLine(i, "");
+        } else if (edit != nullptr || headers.At(i).value != value) {
+            EditLine(i, MakeLine(headers.At(i).name, value));
+        }
+
+        // a header which already has the value is left as is
+        isSet = true;
+    }
+
+    for (auto appended = _appended.begin(); appended != _appended.end();) {
+        if (!name.EqualsIgnoreCase(StringView(appended->line.data(), appended->nameSize))) {
+            appended++;
+        } else if (isSet) {
+            appended = _appended.erase(appended);
+        } else {
+            appended->line = MakeLine(StringView(appended->line.data(), appended->nameSize), value);
+            isSet = true;
+            appended++;
+        }
+    }
+
+    if (!isSet) {
+        Append(name, value);
+    }
+}
+
+void HttpHeadEditor::Remove(StringView name) {
+    const HttpHeaders& headers = _message.Headers();
+
+    for (size_t i = headers.Find(name); i != HttpHeaders::npos; i = headers.Find(name, i + 1)) {
+        EditLine(i, "");
+    }
+
+    _appended.erase(remove_if(_appended.begin(), _appended.end(),
+                              [name](const Appended& appended) {
+                                  return name.EqualsIgnoreCase(StringView(appended.line.data(), appended.nameSize));
+                              }),
+                    _appended.end());
+}
+
+void HttpHeadEditor::Append(StringView name, StringView value) {
+    _appended.push_back(Appended{name.size(), MakeLine(name, value)});
+}
+
+vector<StringView> HttpHeadEditor::Segments() const {
+    const HttpHeaders& headers = _message.Headers();
+    StringView original(_message.OriginalMessage());
+    vector<StringView> segments;
+
+    // lines which follow each other in the original message are joined to a single segment
+    auto add = [&segments](StringView s) {
+        if (!segments.empty() && segments.back().end() == s.data()) {
+            segments.back() = StringView(segments.back().data(), segments.back().size() + s.size());
+        } else if (!s.empty()) {
+            segments.push_back(s);
+        }
+    };
+
+    segments.reserve(3 + 2 * _edits.size() + _appended.size());
+    add(_message.StartLine());
+
+    for (size_t i = 0; i < headers.Size(); i++) {
+        const Edit* edit = FindEdit(i);
+        add(edit == nullptr ? _message.HeaderLine(i) : StringView(edit->line));
+    }
+
+    for (const auto& appended : _appended) {
+        add(appended.line);
+    }
+
+    // the empty line which ends the head and the data after it
+    StringView lastLine = headers.Empty() ? _message.StartLine() : _message.HeaderLine(headers.Size() - 1);
+    add(original.substr(lastLine.end() - original.data()));
+
+    return segments;
+}
+
+void HttpHeadEditor::WriteTo(string& out) const {
+    vector<StringView> segments = Segments();
+    size_t size = out.size();
+
+    for (const auto& segment : segments) {
+        size += segment.size();
+    }
+
+    out.reserve(size);
+
+    for (const auto& segment : segments) {
+        out.append(segment.data(), segment.size());
+    }
+}
+
+BufferChain HttpHeadEditor::ToChain() const {
+    vector<StringView> segments = Segments();
+    StringView original(_message.OriginalMessage());
+    auto lines = make_shared<string>();
+    BufferChain chain;
+
+    for (const auto& segment : segments) {
+        if (segment.data() >= original.begin() && segment.end() <= original.end()) {
+            chain.Append(_message.Buffer(), segment.data() - original.data(), segment.size());
+        } else {
+            // offsets stay valid when lines grows
+            chain.Append(lines, lines->size(), segment.size());
+            lines->append(segment.data(), segment.size());
+        }
+    }
+
+    return chain;
+}
@@ -0,0 +1,196 @@
+#include "http/HttpHeaders.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Names of the well known headers, in the order of HttpHeaderId
+static constexpr const char* KNOWN_HEADERS[] = {
+    "",
+    "Host",
+    "Connection",
+    "Content-Length",
+    "Transfer-Encoding",
+    "Content-Type",
+    "Content-Encoding",
+    "Keep-Alive",
+    "Proxy-Connection",
+    "Upgrade",
+    "Expect",
+    "TE",
+    "Trailer",
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "User-Agent",
+    "Cookie",
+    "Set-Cookie",
+    "Cache-Control",
+    "Date",
+    "Server",
+    "Location",
+    "Referer",
+    "Authorization",
+    "Proxy-Authorization",
+    "Content-Security-Policy",
+    "Via",
+    "X-Forwarded-For",
+};
+
+static_assert(sizeof(KNOWN_HEADERS) / sizeof(KNOWN_HEADERS[0]) == static_cast<size_t>(HttpHeaderId::COUNT),
+              "Every HttpHeaderId must have a name");
+
+// Must be a power of 2 and larger than the number of well known headers
+static constexpr size_t ID_TABLE_SIZE = 64;
+
+static constexpr size_t Length(const char* s) { return *s == '\0' ? 0 : 1 + Length(s + 1); }
+
+static constexpr char Lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+// Case insensitive FNV-1a hash
+static constexpr uint32_t HashName(const char* s, size_t size) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<uint8_t>(Lower(s[i]))) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Open addressing hash table from name to HttpHeaderId, built by the compiler
+struct IdTable {
+    uint8_t slots[ID_TABLE_SIZE];
+
+    constexpr IdTable() : slots() {
+        for (size_t id = 1; id < static_cast<size_t>(HttpHeaderId::COUNT); id++) {
+            size_t slot = HashName(KNOWN_HEADERS[id], Length(KNOWN_HEADERS[id])) & (ID_TABLE_SIZE - 1);
+
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & (ID_TABLE_SIZE - 1);
+            }
+
+            slots[slot] = static_cast<uint8_t>(id);
+        }
+    }
+};
+
+static constexpr IdTable ID_TABLE{};
+
+HttpHeaderId HttpHeaders::IdOf(StringView name) {
+    size_t slot = HashName(name.data(), name.size()) & (ID_TABLE_SIZE - 1);
+
+    while (ID_TABLE.slots[slot] != 0) {
+        uint8_t id = ID_TABLE.slots[slot];
+
+        if (name.EqualsIgnoreCase(KNOWN_HEADERS[id])) {
+            return static_cast<HttpHeaderId>(id);
+        }
+
+        slot = (slot + 1) & (ID_TABLE_SIZE - 1);
+    }
+
+    return HttpHeaderId::UNKNOWN;
+}
+
+StringView HttpHeaders::NameOf(HttpHeaderId id) { return KNOWN_HEADERS[static_cast<size_t>(id)]; }
+
+void HttpHeaders::Reserve(size_t count, size_t bytes) {
+    _entries.reserve(count);
+    _buffer.reserve(bytes);
+}
+
+HttpHeaders::Header HttpHeaders::At(size_t index) const {
+    const Entry& entry = _entries[index];
+
+    return Header{entry.id, StringView(_buffer.data() + entry.nameOffset, entry.nameSize),
+                  StringView(_buffer.data() + entry.valueOffset, entry.valueSize)};
+}
+
+size_t HttpHeaders::Find(HttpHeaderId id, StringView name, size_t start) const {
+    for (size_t i = start; i < _entries.size(); i++) {
+        const Entry& entry = _entries[i];
+
+        // well known headers are compared by id, others by name
+        if (entry.id == id && (id != HttpHeaderId::UNKNOWN ||
+                               name.EqualsIgnoreCase(StringView(_buffer.data() + entry.nameOffset, entry.nameSize)))) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+size_t HttpHeaders::Find(HttpHeaderId id, size_t start) const { return Find(id, StringView(), start); }
+
+size_t HttpHeaders::Find(StringView name, size_t start) const { return Find(IdOf(name), name, start); }
+
+StringView HttpHeaders::Get(HttpHeaderId id) const {
+    size_t index = Find(id);
+    return index == npos ? StringView() : At(index).value;
+}
+
+StringView HttpHeaders::Get(StringView name) const {
+    size_t index = Find(name);
+    return index == npos ? StringView() : At(index).value;
+}
+
+uint32_t HttpHeaders::Store(StringView s) {
+    auto offset = static_cast<uint32_t>(_buffer.size());
+
+    _buffer.append(s.data(), s.size());
+    return offset;
+}
+
+HttpHeaderId HttpHeaders::Add(StringView name, StringView value) {
+    Entry entry{IdOf(name), 0, static_cast<uint32_t>(name.size()), 0, static_cast<uint32_t>(value.size())};
+
+    entry.nameOffset = Store(name);
+    entry.valueOffset = Store(value);
+    _entries.push_back(entry);
+
+    return entry.id;
+}
+
+void HttpHeaders::Set(StringView name, StringView value) {
+    size_t index = Find(name);
+
+    if (index == npos) {
+        Add(name, value);
+        return;
+    }
+
+    Entry& entry = _entries[index];
+
+    // a value which is not longer than the current one is written over it
+    if (value.size() <= entry.valueSize) {
+        copy(value.begin(), value.end(), &_buffer[entry.valueOffset]);
+    } else {
+        entry.valueOffset = Store(value);
+    }
+
+    entry.valueSize = static_cast<uint32_t>(value.size());
+
+    // the first header is kept in its place, the others are removed
+    for (size_t next = Find(name, index + 1); next != npos; next = Find(name, next)) {
+        _entries.erase(_entries.begin() + next);
+    }
+}
+
+size_t HttpHeaders::Remove(StringView name) {
+    HttpHeaderId id = IdOf(name);
+    auto end = remove_if(_entries.begin(), _entries.end(), [&](const Entry& entry) {
+        return entry.id == id &&
+               (id != HttpHeaderId::UNKNOWN ||
+                name.EqualsIgnoreCase(StringView(_buffer.data() + entry.nameOffset, entry.nameSize)));
+    });
+    size_t removed = _entries.end() - end;
+
+    _entries.erase(end, _entries.end());
+    return removed;
+}
+
+void HttpHeaders::Clear() {
+    _buffer.clear();
+    _entries.clear();
+}
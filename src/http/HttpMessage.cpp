@@ -1,6 +1,11 @@
 #include "http/HttpMessage.h"
+#include "http/HttpParser.h"
 #include "utils/Logger.h"
-#include <regex>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -11,25 +16,6 @@ using namespace std;
 
 static const string NEW_LINE = "\r\n";
 
-string Ltrim(const string& s) {
-    static regex re = regex(R"(^\s+)");
-    return regex_replace(s, re, string(""));
-}
-
-string Rtrim(const string& s) {
-    static regex re = regex(R"(\s+$)");
-    return regex_replace(s, re, string(""));
-}
-
-string Trim(const string& s) { return Ltrim(Rtrim(s)); }
-
-string ToLower(const string& s) {
-    string lower;
-    lower.resize(s.size());
-    std::transform(s.begin(), s.end(), lower.begin(), ::tolower);
-    return lower;
-}
-
 const string& HttpMessage::HttpMethodToString(HttpMessage::HttpMethod method) const {
     static unordered_map<HttpMessage::HttpMethod, string> methodToStringDict{
         {HttpMessage::HttpMethod::NONE, "NONE"},       {HttpMessage::HttpMethod::GET, "GET"},
@@ -42,16 +28,22 @@ const string& HttpMessage::HttpMethodToString(HttpMessage::HttpMethod method) co
     return methodToStringDict[method];
 }
 
-HttpMessage::HttpMethod StringToHttpMethod(const string& method) {
-    static unordered_map<string, HttpMessage::HttpMethod> stringToMethodDict{
-        {"NONE", HttpMessage::HttpMethod::NONE},       {"GET", HttpMessage::HttpMethod::GET},
-        {"HEAD", HttpMessage::HttpMethod::HEAD},       {"POST", HttpMessage::HttpMethod::POST},
-        {"PUT", HttpMessage::HttpMethod::PUT},         {"DELETE", HttpMessage::HttpMethod::DELETE},
-        {"CONNECT", HttpMessage::HttpMethod::CONNECT}, {"OPTIONS", HttpMessage::HttpMethod::OPTIONS},
-        {"TRACE", HttpMessage::HttpMethod::TRACE},     {"PATCH", HttpMessage::HttpMethod::PATCH},
+static HttpMessage::HttpMethod StringToHttpMethod(StringView method) {
+    static const pair<StringView, HttpMessage::HttpMethod> stringToMethod[]{
+        {"GET", HttpMessage::HttpMethod::GET},         {"HEAD", HttpMessage::HttpMethod::HEAD},
+        {"POST", HttpMessage::HttpMethod::POST},       {"PUT", HttpMessage::HttpMethod::PUT},
+        {"DELETE", HttpMessage::HttpMethod::DELETE},   {"CONNECT", HttpMessage::HttpMethod::CONNECT},
+        {"OPTIONS", HttpMessage::HttpMethod::OPTIONS}, {"TRACE", HttpMessage::HttpMethod::TRACE},
+        {"PATCH", HttpMessage::HttpMethod::PATCH},
     };
 
-    return stringToMethodDict[method];
+    for (const auto& kv : stringToMethod) {
+        if (kv.first == method) {
+            return kv.second;
+        }
+    }
+
+    return HttpMessage::HttpMethod::NONE;
 }
 
 const string& HttpMessage::HttpStatusCodeGroupToString(HttpMessage::HttpStatusCodeGroup status) const {
@@ -64,22 +56,15 @@ const string& HttpMessage::HttpStatusCodeGroupToString(HttpMessage::HttpStatusCo
     return statusToStringDict[status];
 }
 
-HttpMessage::HttpStatusCodeGroup StringToHttpStatusCodeGroup(const string& status) {
-    static unordered_map<string, HttpMessage::HttpStatusCodeGroup> stringToStatusDict{
-        {"NONE", HttpMessage::HttpStatusCodeGroup::NONE},     {R"(1\d\d)", HttpMessage::HttpStatusCodeGroup::S1XX},
-        {R"(2\d\d)", HttpMessage::HttpStatusCodeGroup::S2XX}, {R"(3\d\d)", HttpMessage::HttpStatusCodeGroup::S3XX},
-        {R"(4\d\d)", HttpMessage::HttpStatusCodeGroup::S4XX}, {R"(5\d\d)", HttpMessage::HttpStatusCodeGroup::S5XX},
-    };
-
-    HttpMessage::HttpStatusCodeGroup result = HttpMessage::HttpStatusCodeGroup::NONE;
-    smatch res;
-    for (const auto& kv : stringToStatusDict) {
-        if (regex_search(status, res, regex(kv.first))) {
-            result = kv.second;
-        }
+// The group is given by the first digit of the 3 digits status code
+static HttpMessage::HttpStatusCodeGroup StringToHttpStatusCodeGroup(StringView status) {
+    if (status.size() != 3 || !all_of(status.begin(), status.end(), ::isdigit) || status[0] < '1' ||
+        status[0] > '5') {
+        return HttpMessage::HttpStatusCodeGroup::NONE;
     }
 
-    return result;
+    return static_cast<HttpMessage::HttpStatusCodeGroup>(
+        static_cast<uint8_t>(HttpMessage::HttpStatusCodeGroup::S1XX) + (status[0] - '1'));
 }
 
 const string& HttpMessage::HttpVersionToString(HttpMessage::HttpVersion version) const {
@@ -92,153 +77,129 @@ const string& HttpMessage::HttpVersionToString(HttpMessage::HttpVersion version)
     return versionToStringDict[version];
 }
 
-HttpMessage::HttpVersion StringToHttpVersion(const string& version) {
-    static unordered_map<string, HttpMessage::HttpVersion> stringToVersionDict{
-        {"NONE", HttpMessage::HttpVersion::UNKNOWN},
-        {"HTTP/1.0", HttpMessage::HttpVersion::V1_0},
-        {"HTTP/1.1", HttpMessage::HttpVersion::V1_1},
-    };
+static HttpMessage::HttpVersion StringToHttpVersion(StringView version) {
+    if (version == "HTTP/1.1") {
+        return HttpMessage::HttpVersion::V1_1;
+    } else if (version == "HTTP/1.0") {
+        return HttpMessage::HttpVersion::V1_0;
+    }
 
-    return stringToVersionDict[version];
+    return HttpMessage::HttpVersion::UNKNOWN;
 }
 
-bool HttpMessage::ParseStartLine(const string& s) {
-    vector<string> startLineParts;
-    string item;
-    stringstream ss(s);
-
-    // Start line is the first line of the HTTP message
-    // In request it looks like this:
-    //     METHOD PATH HTTP_VERSION
-    // In response:
-    //     HTTP_VERSION RESPONSE_CODE RESPONSE_DESCRIPTION
-    while (getline(ss, item, ' ')) {
-        if (item.length() > 0) {
-            startLineParts.emplace_back(item);
+void HttpMessage::ParseStartLine(const HttpParser& parser) {
+    _isRequest = parser.IsRequest();
+    _version = StringToHttpVersion(parser.Version());
+
+    if (_isRequest) {
+        _method = StringToHttpMethod(parser.Method());
+        _path = parser.Path().ToString();
+    } else {
+        _statusCodeGroup = StringToHttpStatusCodeGroup(parser.StatusCode());
+        _status = parser.StatusCode().ToString();
+
+        if (!parser.Reason().empty()) {
+            _status += " ";
+            _status.append(parser.Reason().data(), parser.Reason().size());
         }
     }
+}
 
-    if (startLineParts[0].find("HTTP") == 0) {
-        _isRequest = false;
-        _version = StringToHttpVersion(startLineParts[0]);
-        _statusCodeGroup = StringToHttpStatusCodeGroup(startLineParts[1]);
-
-        ss.str("");
-        ss.clear();
+// Parse a TCP port, returns false if s is not a number between 1 and 65535
+static bool ParsePort(StringView s, uint32_t& port) {
+    unsigned long value = 0;
 
-        for (size_t i = 1; i < startLineParts.size(); i++) {
-            ss << startLineParts[i] << " ";
-        }
+    // header bytes may be negative as char, the ctype functions are undefined for those
+    if (s.empty() || s.size() > 5 || !all_of(s.begin(), s.end(), [](unsigned char c) { return isdigit(c); })) {
+        return false;
+    }
 
-        _status = Trim(ss.str());
-    } else {
-        _isRequest = true;
-        _method = StringToHttpMethod(startLineParts[0]);
-        _path = startLineParts[1];
-        _version = StringToHttpVersion(startLineParts[2]);
+    value = strtoul(s.ToString().c_str(), nullptr, 10);
+    if (value < 1 || value > 65535) {
+        return false;
     }
 
+    port = static_cast<uint32_t>(value);
     return true;
 }
 
-bool HttpMessage::AddNewHeader(const string& s) {
-    string key, value;
-    size_t delimLocation = s.find_first_of(":");
-    key = ToLower(Trim(string(s, 0, delimLocation)));
-    value = Trim(string(s, delimLocation + 1, s.size() - delimLocation - 1));
+bool HttpMessage::AddNewHeader(StringView name, StringView value) {
+    if (_headers.Add(name, value) == HttpHeaderId::HOST) {
+        size_t delimLocation = value.find(':');
 
-    _headers.emplace(key, value);
+        _host = value.substr(0, delimLocation).ToString();
+        _port = 443;
 
-    if (key == "host") {
-        string host = value, port = "443";
-        delimLocation = value.find(":");
-        if (delimLocation != string::npos) {
-            host = string(value, 0, delimLocation);
-            port = string(value, delimLocation + 1, value.size() - delimLocation - 1);
-        }
-
-        _host = host;
-        try {
-            _port = stoi(port);
-        } catch (std::invalid_argument e) {
-            throw new invalid_argument(e.what());
+        if (delimLocation != StringView::npos && !ParsePort(value.substr(delimLocation + 1), _port)) {
+            LOG_TRACE("Invalid port in the host " << value);
+            return false;
         }
     }
 
     return true;
 }
 
-bool HttpMessage::AddData(const string& s) {
-    _data += s;
-    return true;
-}
+bool HttpMessage::ParseMessage(HttpParser& parser) {
+    // a parser which already parsed the head only moves its views to the message
+    HttpParser::Status status = parser.Parse(OriginalMessage());
 
-bool HttpMessage::ParseMessage() {
-    bool parsingResult = true, parsingDone = false;
-    string data = _originalMessage;
-    static regex newLine(R"(.*\r\n)");
-    smatch res;
-    HttpMessage::HttpParsingParts parsingPart = HttpMessage::HttpParsingParts::START_LINE;
-
-    while (parsingResult && !parsingDone && regex_search(data, res, newLine)) {
-        string line = Trim(res.str());
-
-        if (!line.empty()) {
-            switch (parsingPart) {
-            case HttpMessage::HttpParsingParts::START_LINE:
-                parsingResult = ParseStartLine(line);
-                parsingPart = HttpMessage::HttpParsingParts::HEADERS;
-                break;
-            case HttpMessage::HttpParsingParts::HEADERS:
-                parsingResult = AddNewHeader(line);
-                break;
-            case HttpMessage::HttpParsingParts::DATA:
-            default:
-                parsingResult = false;
-                break;
-            }
-        } else {
-            switch (parsingPart) {
-                // Empty line after the start line means a parsing error
-            case HttpMessage::HttpParsingParts::START_LINE:
-                parsingResult = false;
-                break;
-                // Empty line after the headers means end of the headers
-            case HttpMessage::HttpParsingParts::HEADERS:
-                parsingPart = HttpMessage::HttpParsingParts::DATA;
-                parsingDone = true;
-                break;
-            case HttpMessage::HttpParsingParts::DATA:
-            default:
-                parsingResult = false;
-                break;
-            }
+    // A head without the final empty line is accepted, it is parsed up to its last complete line
+    if (status == HttpParser::Status::ERROR) {
+        return false;
+    }
+
+    ParseStartLine(parser);
+    _startLine = ToSpan(parser.StartLine());
+
+    // all the headers are stored in a single buffer no larger than the head
+    _headers.Reserve(parser.HeadersCount(), status == HttpParser::Status::DONE ? parser.HeadSize() : size_t(0));
+    _headerLines.reserve(parser.HeadersCount());
+
+    for (size_t i = 0; i < parser.HeadersCount(); i++) {
+        HttpParser::Header header = parser.GetHeader(i);
+        if (!AddNewHeader(header.name, header.value)) {
+            return false;
         }
 
-        data = res.suffix();
+        _headerLines.push_back(ToSpan(header.line));
     }
 
-    if (parsingResult && parsingPart == HttpMessage::HttpParsingParts::DATA && !data.empty()) {
-        parsingResult = AddData(data);
+    if (status == HttpParser::Status::DONE) {
+        _data = OriginalMessage().substr(parser.HeadSize()).ToString();
     }
 
-    return parsingResult;
+    return true;
 }
 
 bool HttpMessage::Validate() const {
     bool isValid = _isRequest ? (_method != HttpMessage::HttpMethod::NONE && !_path.empty())
                               : (_statusCodeGroup != HttpMessage::HttpStatusCodeGroup::NONE);
 
-    isValid = isValid && !_headers.empty() && _version != HttpMessage::HttpVersion::UNKNOWN;
+    isValid = isValid && !_headers.Empty() && _version != HttpMessage::HttpVersion::UNKNOWN;
 
     return isValid;
 }
 
 HttpMessage::HttpMessage(const string& message)
-    : _originalMessage(std::move(message)), _isRequest(false), _method(HttpMessage::HttpMethod::NONE), _host(""),
-      _path(""), _port(443), _headers({}), _version(HttpMessage::HttpVersion::UNKNOWN),
-      _statusCodeGroup(HttpMessage::HttpStatusCodeGroup::NONE), _status(""), _data("") {
-    bool res = ParseMessage();
+    : _buffer(make_shared<const string>(message)), _size(message.size()), _isRequest(false),
+      _method(HttpMessage::HttpMethod::NONE), _host(""),
+      _path(""), _port(443), _headers(), _version(HttpMessage::HttpVersion::UNKNOWN),
+      _statusCodeGroup(HttpMessage::HttpStatusCodeGroup::NONE), _status(""), _data(""), _startLine({0, 0}),
+      _headerLines() {
+    HttpParser parser;
+    Init(parser);
+}
+
+HttpMessage::HttpMessage(SharedBuffer buffer, size_t size, HttpParser& parser)
+    : _buffer(std::move(buffer)), _size(size), _isRequest(false), _method(HttpMessage::HttpMethod::NONE), _host(""),
+      _path(""), _port(443), _headers(), _version(HttpMessage::HttpVersion::UNKNOWN),
+      _statusCodeGroup(HttpMessage::HttpStatusCodeGroup::NONE), _status(""), _data(""), _startLine({0, 0}),
+      _headerLines() {
+    Init(parser);
+}
+
+void HttpMessage::Init(HttpParser& parser) {
+    bool res = ParseMessage(parser);
 
     if (!res) {
         LOG_TRACE("Failed to parse HTTP message");
@@ -256,8 +217,8 @@ HttpMessage::HttpMessage(const string& message)
 std::string HttpMessage::CommonHttpMessageToString() const {
     stringstream ss;
 
-    for (const auto& kv : _headers) {
-        ss << kv.first << ": " << kv.second << NEW_LINE;
+    for (const auto& header : _headers) {
+        ss << header.name << ": " << header.value << NEW_LINE;
     }
 
     ss << NEW_LINE;
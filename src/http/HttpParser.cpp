@@ -0,0 +1,143 @@
+#include "http/HttpParser.h"
+#include "http/HttpScanner.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Return the next space separated token of s starting at pos, pos is moved past it
+static StringView NextToken(StringView s, size_t& pos) {
+    while (pos < s.size() && s[pos] == ' ') {
+        pos++;
+    }
+
+    size_t end = min(s.find(' ', pos), s.size());
+    StringView token = s.substr(pos, end - pos);
+
+    pos = end;
+    return token;
+}
+
+HttpParser::HttpParser()
+    : _data(nullptr), _status(Status::INCOMPLETE), _lineStart(0), _scanOffset(0), _headSize(0), _isStartLine(true),
+      _isRequest(false), _startLine({0, 0}), _method({0, 0}), _path({0, 0}), _version({0, 0}), _statusCode({0, 0}),
+      _reason({0, 0}), _statusCodeValue(0), _headers() {}
+
+void HttpParser::Reset() {
+    _data = nullptr;
+    _status = Status::INCOMPLETE;
+    _lineStart = 0;
+    _scanOffset = 0;
+    _headSize = 0;
+    _isStartLine = true;
+    _isRequest = false;
+    _startLine = _method = _path = _version = _statusCode = _reason = Span{0, 0};
+    _statusCodeValue = 0;
+    _headers.clear();
+}
+
+bool HttpParser::ParseStartLine(StringView line, size_t lineSize) {
+    size_t pos = 0;
+    StringView first = NextToken(line, pos);
+    StringView second = NextToken(line, pos);
+
+    // Start line is the first line of the HTTP message
+    // In request it looks like this:
+    //     METHOD PATH HTTP_VERSION
+    // In response:
+    //     HTTP_VERSION RESPONSE_CODE RESPONSE_DESCRIPTION
+    if (first.empty() || second.empty()) {
+        return false;
+    }
+
+    _startLine = Span{static_cast<uint32_t>(line.data() - _data), static_cast<uint32_t>(lineSize)};
+
+    if (first.StartsWith("HTTP/")) {
+        // status-code = 3DIGIT, the framer and the access log use its value
+        if (second.size() != 3 || !all_of(second.begin(), second.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+
+        _isRequest = false;
+        _statusCodeValue = static_cast<uint16_t>((second[0] - '0') * 100 + (second[1] - '0') * 10 + (second[2] - '0'));
+        _version = ToSpan(first);
+        _statusCode = ToSpan(second);
+        _reason = ToSpan(line.substr(pos).Trim());
+    } else {
+        StringView third = NextToken(line, pos);
+
+        if (third.empty() || !NextToken(line, pos).empty() ||
+            HttpScanner::FindTokenEnd(first.data(), first.size()) != first.size()) {
+            return false;
+        }
+
+        _isRequest = true;
+        _method = ToSpan(first);
+        _path = ToSpan(second);
+        _version = ToSpan(third);
+    }
+
+    return true;
+}
+
+bool HttpParser::ParseHeaderLine(StringView line, size_t lineSize) {
+    size_t colon = HttpScanner::FindTokenEnd(line.data(), line.size());
+
+    // the name is a token followed right away by the colon, this rejects white space before the colon and
+    // obsolete line folding (a line starting with white space)
+    if (colon == 0 || colon == line.size() || line[colon] != ':') {
+        return false;
+    }
+
+    _headers.push_back(HeaderSpan{ToSpan(line.substr(0, colon)), ToSpan(line.substr(colon + 1).Trim()),
+                                  Span{static_cast<uint32_t>(line.data() - _data), static_cast<uint32_t>(lineSize)}});
+    return true;
+}
+
+HttpParser::Status HttpParser::Parse(const char* data, size_t size) {
+    _data = data;
+
+    while (_status == Status::INCOMPLETE && _lineStart < size) {
+        // a line ends at the first control character, which must be CRLF or a bare LF
+        size_t scanStart = max(_lineStart, _scanOffset);
+        size_t lineEnd = scanStart + HttpScanner::FindFieldEnd(data + scanStart, size - scanStart);
+        size_t next = lineEnd + 1;
+
+        _scanOffset = lineEnd;
+
+        if (lineEnd == size || (data[lineEnd] == '\r' && lineEnd + 1 == size)) {
+            break;
+        } else if (data[lineEnd] == '\r' && data[lineEnd + 1] == '\n') {
+            next++;
+        } else if (data[lineEnd] != '\n') {
+            _status = Status::ERROR;
+            break;
+        }
+
+        StringView line(data + _lineStart, lineEnd - _lineStart);
+
+        if (line.empty()) {
+            // Empty line after the start line means a parsing error, after the headers it ends the head
+            _status = _isStartLine ? Status::ERROR : Status::DONE;
+            _headSize = next;
+        } else if (_isStartLine ? !ParseStartLine(line, next - _lineStart)
+                                : !ParseHeaderLine(line, next - _lineStart)) {
+            _status = Status::ERROR;
+        }
+
+        _isStartLine = false;
+        _lineStart = next;
+    }
+
+    return _status;
+}
+
+StringView HttpParser::FindHeader(StringView name) const {
+    for (const auto& header : _headers) {
+        if (View(header.name).EqualsIgnoreCase(name)) {
+            return View(header.value);
+        }
+    }
+
+    return StringView();
+}
@@ -0,0 +1,230 @@
+#include "http/HttpScanner.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCANNER_X86
+#endif
+
+using namespace std;
+
+// Per byte classification used by the scalar kernel and to build the SIMD lookup tables
+struct CharTable {
+    bool isField[256];
+    bool isToken[256];
+
+    // Bitmaps of the token characters for the AVX2 kernel, a byte is a token character if
+    // tokenLow[low nibble] & tokenHigh[high nibble] is not 0. Each table is repeated for both 128 bit lanes
+    alignas(32) uint8_t tokenLow[32];
+    alignas(32) uint8_t tokenHigh[32];
+
+    CharTable() {
+        for (int c = 0; c < 256; c++) {
+            isField[c] = c == '\t' || (c >= 0x20 && c != 0x7f);
+            isToken[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c != 0 && strchr("!#$%&'*+-.^_`|~", c) != nullptr);
+        }
+
+        // token characters are all below 0x80, so a high nibble of 8 or more matches no bit
+        for (int i = 0; i < 16; i++) {
+            uint8_t low = 0;
+
+            for (int high = 0; high < 8; high++) {
+                low |= isToken[(high << 4) | i] ? (1 << high) : 0;
+            }
+
+            tokenLow[i] = tokenLow[i + 16] = low;
+            tokenHigh[i] = tokenHigh[i + 16] = i < 8 ? (1 << i) : 0;
+        }
+    }
+};
+
+static const CharTable TABLE;
+
+static size_t FindFieldEndScalar(const char* data, size_t size) {
+    size_t i = 0;
+
+    while (i < size && TABLE.isField[static_cast<uint8_t>(data[i])]) {
+        i++;
+    }
+
+    return i;
+}
+
+static size_t FindTokenEndScalar(const char* data, size_t size) {
+    size_t i = 0;
+
+    while (i < size && TABLE.isToken[static_cast<uint8_t>(data[i])]) {
+        i++;
+    }
+
+    return i;
+}
+
+#ifdef HTTP_SCANNER_X86
+
+// The byte ranges which end a field value
+static const char FIELD_END_RANGES[16] = {0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f};
+
+// The byte ranges which may end a token, '|' and '~' are in the last range although they are token characters
+// since only 8 ranges fit, a match is checked again with the table
+static const char TOKEN_END_RANGES[16] = {0x00, 0x20, 0x22, 0x22, 0x28, 0x29, 0x2c, 0x2c,
+                                          0x2f, 0x2f, 0x3a, 0x40, 0x5b, 0x5d, 0x7b, static_cast<char>(0xff)};
+
+__attribute__((target("sse4.2"))) static size_t FindFieldEndSse42(const char* data, size_t size) {
+    const __m128i ranges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(FIELD_END_RANGES));
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int index = _mm_cmpestri(ranges, 6, chars, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+
+        if (index != 16) {
+            return i + index;
+        }
+    }
+
+    return i + FindFieldEndScalar(data + i, size - i);
+}
+
+__attribute__((target("sse4.2"))) static size_t FindTokenEndSse42(const char* data, size_t size) {
+    const __m128i ranges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(TOKEN_END_RANGES));
+    size_t i = 0;
+
+    while (i + 16 <= size) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int index = _mm_cmpestri(ranges, 16, chars, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+
+        if (index == 16) {
+            i += 16;
+        } else if (!TABLE.isToken[static_cast<uint8_t>(data[i + index])]) {
+            return i + index;
+        } else {
+            i += index + 1;
+        }
+    }
+
+    return i + FindTokenEndScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) static size_t FindFieldEndAvx2(const char* data, size_t size) {
+    const __m256i maxControl = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+        // control characters are the bytes which are not changed by min(byte, 0x1f)
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chars, maxControl), chars);
+        __m256i end = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(chars, tab), control),
+                                      _mm256_cmpeq_epi8(chars, del));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(end));
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    // the tail is not passed to the SSE4.2 kernel, switching from AVX to legacy SSE code stalls the CPU
+    return i + FindFieldEndScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) static size_t FindTokenEndAvx2(const char* data, size_t size) {
+    const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(TABLE.tokenLow));
+    const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(TABLE.tokenHigh));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i lowBits = _mm256_shuffle_epi8(low, _mm256_and_si256(chars, nibble));
+        __m256i highBits = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(chars, 4), nibble));
+        __m256i notToken = _mm256_cmpeq_epi8(_mm256_and_si256(lowBits, highBits), _mm256_setzero_si256());
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(notToken));
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + FindTokenEndScalar(data + i, size - i);
+}
+
+static bool IsSupported(HttpScanner::Kernel kernel) {
+    __builtin_cpu_init();
+
+    switch (kernel) {
+    case HttpScanner::Kernel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+    case HttpScanner::Kernel::SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    default:
+        return true;
+    }
+}
+
+#else
+
+static bool IsSupported(HttpScanner::Kernel kernel) { return kernel == HttpScanner::Kernel::SCALAR; }
+
+#endif
+
+static HttpScanner::Kernel DetectKernel() {
+    if (IsSupported(HttpScanner::Kernel::AVX2)) {
+        return HttpScanner::Kernel::AVX2;
+    } else if (IsSupported(HttpScanner::Kernel::SSE42)) {
+        return HttpScanner::Kernel::SSE42;
+    }
+
+    return HttpScanner::Kernel::SCALAR;
+}
+
+HttpScanner::Kernel HttpScanner::_kernel = DetectKernel();
+
+size_t HttpScanner::FindFieldEnd(const char* data, size_t size) {
+    switch (_kernel) {
+#ifdef HTTP_SCANNER_X86
+    case Kernel::AVX2:
+        return FindFieldEndAvx2(data, size);
+    case Kernel::SSE42:
+        return FindFieldEndSse42(data, size);
+#endif
+    default:
+        return FindFieldEndScalar(data, size);
+    }
+}
+
+size_t HttpScanner::FindTokenEnd(const char* data, size_t size) {
+    switch (_kernel) {
+#ifdef HTTP_SCANNER_X86
+    case Kernel::AVX2:
+        return FindTokenEndAvx2(data, size);
+    case Kernel::SSE42:
+        return FindTokenEndSse42(data, size);
+#endif
+    default:
+        return FindTokenEndScalar(data, size);
+    }
+}
+
+const char* HttpScanner::KernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AVX2:
+        return "AVX2";
+    case Kernel::SSE42:
+        return "SSE4.2";
+    default:
+        return "scalar";
+    }
+}
+
+bool HttpScanner::SetKernel(Kernel kernel) {
+    if (!IsSupported(kernel)) {
+        return false;
+    }
+
+    _kernel = kernel;
+    return true;
+}
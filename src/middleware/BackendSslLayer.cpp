@@ -6,41 +6,18 @@
 #include <unistd.h>
 
 #include "middleware/BackendSslLayer.h"
-
-std::shared_ptr<Message> BackendSslLayer::ProcessMessage(std::shared_ptr<Message> msg) {
-    std::shared_ptr<Message> res = nullptr;
-    auto data = std::dynamic_pointer_cast<StringDataMessage>(msg);
-
-    if (_ssl == nullptr) {
-        res = std::make_shared<ErrorMessage>("SSL object is null");
-    } else if (data == nullptr) {
-        res = std::make_shared<ErrorMessage>("Message should be of type StringData");
-    } else {
-        // Check if the backend ssl connection was already established
-        if (SSL_is_init_finished(_ssl) <= 0 && !Connect()) {
-            ERR_print_errors_fp(stderr);
-        } else {
-            DoSslWrite(data->Data);
-            std::string serverResponse = DoSslRead();
-            DoClose(true);
-            res = std::make_shared<StringDataMessage>(serverResponse);
-        }
-    }
-
-    return res;
-}
+#include "utils/Logger.h"
 
 X509_PTR BackendSslLayer::GetCertificate() {
     DEF_X509(res, nullptr);
 
-    // Check if the backend ssl connection was already established
-    if (SSL_is_init_finished(_ssl) <= 0 && !Connect()) {
-        ERR_print_errors_fp(stderr);
+    if (_ssl == nullptr || SSL_is_init_finished(_ssl) <= 0) {
+        LOG_ERROR("Backend ssl connection is not established");
     } else {
         res = SSL_get_peer_certificate(_ssl);
     }
 
-    return res;
+    return res.Pop();
 }
 
-bool BackendSslLayer::Connect() { return DoSslConnectAccept(); }
\ No newline at end of file
+SslStatus BackendSslLayer::Connect() { return DoSslConnectAccept(); }
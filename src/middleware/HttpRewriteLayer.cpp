@@ -1,39 +1,43 @@
+#include <algorithm>
 #include <iostream>
-#include <regex>
 
-#include "http/HttpMessageBuilder.h"
+#include "http/HttpHeaders.h"
 #include "middleware/HttpRewriteLayer.h"
-#include <stdexcept>
 
-std::string ForceConnectionClose(const std::string& httpMessage) {
-    HttpMessageBuilder msg(httpMessage);
+// Return true if one of the Connection headers lists token, case insensitive
+static bool HasConnectionToken(const HttpHeaders& headers, StringView token) {
+    for (size_t i = headers.Find(HttpHeaderId::CONNECTION); i != HttpHeaders::npos;
+         i = headers.Find(HttpHeaderId::CONNECTION, i + 1)) {
+        StringView list = headers.At(i).value;
+        size_t start = 0;
 
-    msg.Headers()["connection"] = "keep-alive";
+        while (start <= list.size()) {
+            size_t end = std::min(list.find(',', start), list.size());
 
-    return msg.Build().ToString();
-}
-
-std::shared_ptr<Message> HttpRewriteLayer::ProcessMessage(std::shared_ptr<Message> msg) {
-    std::shared_ptr<Message> res = nullptr;
-    auto data = std::dynamic_pointer_cast<StringDataMessage>(msg);
-
-    if (data == nullptr) {
-        res = std::make_shared<ErrorMessage>("Message should be of type StringData");
-    } else {
-        try {
-            res = PushToNext(std::make_shared<StringDataMessage>(ForceConnectionClose(data->Data)));
-
-            data = std::dynamic_pointer_cast<StringDataMessage>(res);
-            if (data == nullptr) {
-                res = std::make_shared<ErrorMessage>("Message should be of type StringData");
-            } else {
-                res = std::make_shared<StringDataMessage>(ForceConnectionClose(data->Data));
+            if (list.substr(start, end - start).Trim().EqualsIgnoreCase(token)) {
+                return true;
             }
-        } catch (std::invalid_argument* e) {
-            res = std::make_shared<ErrorMessage>(e->what());
-            LOG_ERROR(e->what());
+
+            start = end + 1;
         }
     }
 
-    return res;
-}
\ No newline at end of file
+    return false;
+}
+
+Message HttpRewriteLayer::Rewrite(Message msg) {
+    if (msg.Type() != MessageTypes::HTTP_HEAD) {
+        return Message::Error(msg.Id(), "Message should be of type HttpHead");
+    }
+
+    const HttpMessage& http = msg.Head->Http;
+    const HttpHeaders& headers = http.Headers();
+
+    // only a HTTP/1.0 connection closes by default, the client's close and upgrade tokens are kept
+    if (http.Version() != HttpMessage::HttpVersion::V1_1 && !HasConnectionToken(headers, "close") &&
+        !HasConnectionToken(headers, "upgrade") && !HasConnectionToken(headers, "keep-alive")) {
+        msg.Head->Edits.Set(HttpHeaders::NameOf(HttpHeaderId::CONNECTION), "keep-alive");
+    }
+
+    return msg;
+}
@@ -1,52 +1,57 @@
-#include <chrono>
-#include <iomanip>
-#include <iostream>
-#include <regex>
+#include <ostream>
 
 #include "http/HttpMessage.h"
 #include "middleware/LogHttpLayer.h"
+#include "utils/AccessLog.h"
+#include "utils/Logger.h"
 
 void LogHttpLayer::LogHttpMessage(const HttpMessage& httpMessage) {
-    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    std::stringstream ss;
+    // queued as a single entry so the lines of a message are not mixed with other lines
+    LogLine line;
+    std::ostream& ss = line.Stream();
 
-    ss << "[HTTP ] [" << std::put_time(std::localtime(&now), "%T %F") << "] " << std::endl;
+    ss << "[HTTP ] [" << Logger::Instance().Timestamp() << "] " << '\n';
     ss << "\t" << (httpMessage.IsRequest() ? "Send request (" : "Got response (")
        << (httpMessage.IsRequest() ? httpMessage.HttpMethodToString(httpMessage.Method()) : httpMessage.Status())
-       << ") " << (httpMessage.IsRequest() ? "to " : "from ") << _remoteHost << " on port " << _remotePort << std::endl;
+       << ") " << (httpMessage.IsRequest() ? "to " : "from ") << _remoteHost << " on port " << _remotePort << '\n';
 
-    ss << "\tHeaders:" << std::endl;
+    ss << "\tHeaders:" << '\n';
     for (const auto& header : httpMessage.Headers()) {
-        ss << "\t  " << header.first << ": " << header.second << std::endl;
+        ss << "\t  " << header.name << ": " << header.value << '\n';
     }
 
-    ss << "\tData size: " << httpMessage.Data().size() << std::endl;
+    // the body is streamed and does not pass through the middleware, log its declared size
+    ss << "\tData size: "
+       << (httpMessage.Headers().Has(HttpHeaderId::CONTENT_LENGTH)
+               ? httpMessage.Headers().Get(HttpHeaderId::CONTENT_LENGTH)
+               : StringView("unknown"))
+       << '\n';
+}
+
+Message LogHttpLayer::LogRequest(Message msg) {
+    if (msg.Type() != MessageTypes::HTTP_HEAD) {
+        return Message::Error(msg.Id(), "Message should be of type HttpHead");
+    }
+
+    _remoteHost = msg.Head->Http.Host();
+    _remotePort = msg.Head->Http.Port();
 
-    std::cout << ss.str();
+    // the binary access log replaces the text output
+    if (!AccessLog::IsEnabled()) {
+        LogHttpMessage(msg.Head->Http);
+    }
+
+    return msg;
 }
 
-std::shared_ptr<Message> LogHttpLayer::ProcessMessage(std::shared_ptr<Message> msg) {
-    std::shared_ptr<Message> res = nullptr;
-    auto data = std::dynamic_pointer_cast<StringDataMessage>(msg);
-
-    if (data == nullptr) {
-        res = std::make_shared<ErrorMessage>("Message should be of type StringData");
-    } else {
-        HttpMessage request(data->Data);
-        _remoteHost = request.Host();
-        _remotePort = request.Port();
-
-        LogHttpMessage(request);
-        res = PushToNext(data);
-
-        data = std::dynamic_pointer_cast<StringDataMessage>(res);
-        if (data == nullptr) {
-            res = std::make_shared<ErrorMessage>("Message should be of type StringData");
-        } else {
-            HttpMessage response(data->Data);
-            LogHttpMessage(response);
-        }
+Message LogHttpLayer::LogResponse(Message msg) {
+    if (msg.Type() != MessageTypes::HTTP_HEAD) {
+        return Message::Error(msg.Id(), "Message should be of type HttpHead");
+    }
+
+    if (!AccessLog::IsEnabled()) {
+        LogHttpMessage(msg.Head->Http);
     }
 
-    return res;
+    return msg;
 }
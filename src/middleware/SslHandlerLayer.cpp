@@ -1,156 +1,170 @@
+#include <algorithm>
 #include <fcntl.h>
 #include <iostream>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
-#include <sys/select.h>
 #include <unistd.h>
 
 #include "common/OpenSslCpp.h"
 #include "core/SslHandlerLayer.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 
-constexpr int32_t BUFFER_SIZE = 1024000;
+constexpr int32_t READ_CHUNK_SIZE = 16384;
 
-bool SslHandlerLayer::HandleSslError(int32_t ret) {
-    bool stopOp = false;
+SslHandlerLayer::SslHandlerLayer(SSL_OPTR ssl)
+    : _ssl(std::move(ssl)), _socket(SSL_get_fd(_ssl)), _connectionWasClosed(false), _sslFailed(false) {
+    // non-blocking writes may be retried with a buffer that moved or was partially consumed
+    SSL_set_mode(_ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SetNonBlockingMode();
+}
+
+SslStatus SslHandlerLayer::HandleSslError(int32_t ret) {
+    SslStatus status = SslStatus::ERROR;
     int error = SSL_get_error(_ssl, ret);
     char* errBioBuff;
     long errStrLen = 0;
     DEF_BIO(errBio, BIO_new(BIO_s_mem()));
 
     LOG_TRACE("Handeling error " << error);
+    Metrics::CountSslError(error);
 
     switch (error) {
     case SSL_ERROR_NONE:
+        status = SslStatus::OK;
+        break;
     case SSL_ERROR_WANT_READ:
     case SSL_ERROR_WANT_WRITE:
+        status = SslStatus::WANT_IO;
+        break;
+    case SSL_ERROR_WANT_CLIENT_HELLO_CB:
+        status = SslStatus::WANT_CERTIFICATE;
         break;
     case SSL_ERROR_ZERO_RETURN:
-        if (ret == -1) {
-            break;
-        }
-
-        stopOp = true;
-        ERR_print_errors(errBio);
-        DoClose(true);
+        status = SslStatus::CLOSED;
         break;
     case SSL_ERROR_SYSCALL:
+        // EOF without close_notify, a lot of HTTPS servers just close the socket
+        if (ret == 0 && ERR_peek_error() == 0) {
+            status = SslStatus::CLOSED;
+            _sslFailed = true;
+            break;
+        }
+        // fall through
     case SSL_ERROR_SSL:
-        stopOp = true;
+        status = SslStatus::ERROR;
+        _sslFailed = true;
         ERR_print_errors(errBio);
-        DoClose(false);
         break;
     }
 
     if ((errStrLen = BIO_get_mem_data(errBio, &errBioBuff)) > 0) {
-        LOG_ERROR(errBioBuff);
+        LOG_ERROR(std::string(errBioBuff, errStrLen));
     }
 
-    return stopOp;
+    return status;
 }
 
-std::string SslHandlerLayer::DoSslRead() {
+SslStatus SslHandlerLayer::DoSslRead(std::string& data, size_t maxSize) {
+    char buffer[READ_CHUNK_SIZE];
+    int32_t bytes = 0;
+
     if (_ssl == nullptr) {
-        return "";
+        return SslStatus::ERROR;
     }
 
-    ToggleBlockingMode();
+    // edge-triggered notifications, keep reading until the socket is drained or data is full
+    while (data.size() < maxSize) {
+        ERR_clear_error();
+        bytes = SSL_read(_ssl, buffer, std::min<size_t>(sizeof(buffer), maxSize - data.size()));
 
-    char buffer[BUFFER_SIZE] = {0};
-    int bufferIndex = 0;
-    int32_t bytes = 0;
-    fd_set rfds;
-    struct timeval tv;
-    int retval;
-
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-
-    for (;;) {
-        FD_ZERO(&rfds);
-        FD_SET(_socket, &rfds);
-
-        retval = select(_socket + 1, &rfds, nullptr, nullptr, &tv);
-
-        if (retval == -1) {
-            LOG_ERROR("Error in select");
-        } else if (retval) {
-            bytes = SSL_read(_ssl, buffer + bufferIndex, BUFFER_SIZE - 1);
-
-            if (bytes > 0) {
-                bufferIndex += bytes;
-            } else {
-                if (HandleSslError(bytes)) {
-                    break;
-                }
-            }
+        if (bytes > 0) {
+            data.append(buffer, bytes); // in order to support null characters use the explicit length
         } else {
-            break;
+            return HandleSslError(bytes);
         }
     }
 
-    ToggleBlockingMode();
-    return std::string(buffer, bufferIndex); // in order to support null characters use the explicit ctor
+    return SslStatus::OK;
 }
 
-int32_t SslHandlerLayer::DoSslWrite(const std::string& data) {
+SslStatus SslHandlerLayer::DoSslWrite(const BufferChain& data, size_t& offset) {
+    char buffer[READ_CHUNK_SIZE];
+    int32_t bytes = 0;
+
     if (_ssl == nullptr) {
-        return 0;
+        return SslStatus::ERROR;
     }
 
-    int32_t bytes = SSL_write(_ssl, data.c_str(), data.size());
+    while (offset < data.Size()) {
+        const std::vector<BufferSlice>& slices = data.Slices();
+        size_t slice = 0;
+        size_t start = offset;
+
+        while (start >= slices[slice].size) {
+            start -= slices[slice].size;
+            slice++;
+        }
+
+        StringView chunk = slices[slice].View().substr(start);
+
+        // there is no gather write, slices which fit a record together (such as the lines of a changed head) are
+        // joined instead of sending a record for each of them. A retry after WANT_IO joins the same bytes again
+        if (slice + 1 < slices.size() && chunk.size() + slices[slice + 1].size <= sizeof(buffer)) {
+            size_t size = 0;
+
+            for (; slice < slices.size() && size + chunk.size() <= sizeof(buffer); slice++) {
+                std::copy(chunk.begin(), chunk.end(), buffer + size);
+                size += chunk.size();
+                chunk = slice + 1 < slices.size() ? slices[slice + 1].View() : StringView();
+            }
 
-    if (bytes <= 0) {
-        HandleSslError(bytes);
+            chunk = StringView(buffer, size);
+        }
+
+        ERR_clear_error();
+        bytes = SSL_write(_ssl, chunk.data(), chunk.size());
+
+        if (bytes > 0) {
+            offset += bytes;
+        } else {
+            return HandleSslError(bytes);
+        }
     }
 
-    return bytes;
+    return SslStatus::OK;
 }
 
-bool SslHandlerLayer::DoSslConnectAccept() {
+SslStatus SslHandlerLayer::DoSslConnectAccept() {
     int32_t res = 0;
 
     if (_ssl == nullptr) {
-        return false;
+        return SslStatus::ERROR;
     }
 
+    ERR_clear_error();
     if (SSL_is_server(_ssl)) {
         res = SSL_accept(_ssl);
     } else {
         res = SSL_connect(_ssl);
     }
 
-    LOG_TRACE("Ssl connected");
     if (res <= 0) {
-        HandleSslError(res);
+        return HandleSslError(res);
     }
 
-    return res > 0;
-}
-
-void ShutdownSsl(SSL_PTR ssl) {
-    int32_t ret = 0;
-
-    do {
-        ret = SSL_shutdown(ssl);
-        if (ret < 0) {
-            switch (SSL_get_error(ssl, ret)) {
-            case SSL_ERROR_WANT_READ:
-            case SSL_ERROR_WANT_WRITE:
-            case SSL_ERROR_WANT_ASYNC:
-            case SSL_ERROR_WANT_ASYNC_JOB:
-                continue;
-            }
-            ret = 0;
-        }
-    } while (ret < 0);
+    LOG_TRACE("Ssl connected");
+    return SslStatus::OK;
 }
 
 void SslHandlerLayer::DoClose(bool shutdown) {
     if (!_connectionWasClosed && _ssl != nullptr) {
         _connectionWasClosed = true;
-        if (shutdown) {
-            ShutdownSsl(_ssl);
+
+        // a single non-blocking attempt to send close_notify, we don't wait for the peer's reply
+        if (shutdown && !_sslFailed && SSL_is_init_finished(_ssl)) {
+            ERR_clear_error();
+            SSL_shutdown(_ssl);
         }
         close(_socket);
 
@@ -159,11 +173,10 @@ void SslHandlerLayer::DoClose(bool shutdown) {
     }
 }
 
-void SslHandlerLayer::ToggleBlockingMode() {
+void SslHandlerLayer::SetNonBlockingMode() {
     int32_t flags = fcntl(_socket, F_GETFL, 0);
 
-    if (flags >= 0) {
-        flags = (flags & O_NONBLOCK) ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
-        fcntl(_socket, F_SETFL, flags);
+    if (flags >= 0 && !(flags & O_NONBLOCK)) {
+        fcntl(_socket, F_SETFL, flags | O_NONBLOCK);
     }
-}
\ No newline at end of file
+}
@@ -8,7 +8,7 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <netdb.h>
+#include <mutex>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
 #include <sys/socket.h>
@@ -16,87 +16,118 @@
 
 using namespace std;
 
-SslClient::SslClient(std::unique_ptr<SslClientConfig> config)
-    : _config(std::move(config)), _ctx(nullptr, SSL_CTX_free), _socket(-1) {}
+// the most recent session of every origin (host:port) is kept
+constexpr size_t MAX_UPSTREAM_SESSIONS = 10000;
 
-int32_t SslClient::CreateSocket() {
+static std::once_flag contextOnce;
+static SSL_CTX_OPTR sharedContext(nullptr, SSL_CTX_free);
+static SessionCache upstreamSessions(MAX_UPSTREAM_SESSIONS);
+
+// the ex_data index of the origin of an upstream connection, its sessions arrive only after it was handed to the
+// UpstreamPool (TLS 1.3 tickets are sent after the handshake) so it holds a copy of the key and not the client
+static int32_t originIndex = -1;
+
+static void FreeOrigin(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp) {
+    delete reinterpret_cast<string*>(ptr);
+}
+
+SslClient::SslClient(std::unique_ptr<SslClientConfig> config) : _config(std::move(config)) {}
+
+SessionCacheStats SslClient::GetSessionStats() { return upstreamSessions.GetStats(); }
+
+int32_t SslClient::CreateSocket(const struct sockaddr_storage& serverAddr) {
     int s = 0, res = 0;
-    struct sockaddr_in localAddr;
-    struct sockaddr_in serverAddr;
-    struct hostent* resolvedServerAddress;
-    struct timeval timeout;
-    timeout.tv_sec = 2;
-    timeout.tv_usec = 0;
+    struct sockaddr_storage localAddr;
+    socklen_t len = serverAddr.ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
 
     memset(&localAddr, 0, sizeof(localAddr));
-    memset(&serverAddr, 0, sizeof(serverAddr));
 
-    s = res = socket(AF_INET, SOCK_STREAM, 0);
+    s = res = socket(serverAddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (s < 0) {
         LOG_ERROR("Unable to create socket (" << std::strerror(errno) << ")");
         return res;
     }
 
-    if ((res = setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&timeout), sizeof(timeout))) < 0 ||
-        (res = setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<char*>(&timeout), sizeof(timeout))) < 0) {
-        LOG_ERROR("Unable to set socket options (" << std::strerror(errno) << ")");
-        return res;
-    }
-
-    if ((resolvedServerAddress = gethostbyname(_config->serverIp.c_str())) == nullptr) {
-        LOG_ERROR("No such host");
-        exit(0);
+    // set local ip and port bindings, only the family of the local ip can be bound to it
+    if (inet_pton(serverAddr.ss_family, _config->localIp.c_str(),
+                  serverAddr.ss_family == AF_INET6
+                      ? static_cast<void*>(&reinterpret_cast<struct sockaddr_in6&>(localAddr).sin6_addr)
+                      : static_cast<void*>(&reinterpret_cast<struct sockaddr_in&>(localAddr).sin_addr)) == 1) {
+        localAddr.ss_family = serverAddr.ss_family;
+
+        if ((res = bind(s, reinterpret_cast<const struct sockaddr*>(&localAddr), len)) < 0) {
+            LOG_ERROR("Unable to bind (" << std::strerror(errno) << ")");
+            close(s);
+            return res;
+        }
     }
 
-    // set local ip and port bindings
-    localAddr.sin_family = AF_INET;
-    localAddr.sin_port = 0;
-    localAddr.sin_addr.s_addr = inet_addr(_config->localIp.c_str());
-
-    if ((res = bind(s, reinterpret_cast<struct sockaddr*>(&localAddr), sizeof(localAddr))) < 0) {
-        LOG_ERROR("Unable to bind (" << std::strerror(errno) << ")");
+    // the connect completes in the background, UpstreamConnector reports when it is done
+    if ((res = connect(s, reinterpret_cast<const struct sockaddr*>(&serverAddr), len)) < 0 && errno != EINPROGRESS) {
+        LOG_TRACE("Unable to connect (" << std::strerror(errno) << ")");
+        close(s);
         return res;
     }
 
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(_config->serverPort);
-    serverAddr.sin_addr =
-        *reinterpret_cast<struct in_addr*>(resolvedServerAddress->h_addr_list[0]); // use the first ip avaiable
+    return s;
+}
 
-    if ((res = connect(s, reinterpret_cast<struct sockaddr*>(&serverAddr), sizeof(serverAddr))) < 0) {
-        LOG_ERROR("Unable to connect (" << std::strerror(errno) << ")");
-        return res;
+int32_t SslClient::NewSessionCb(SSL_PTR ssl, SSL_SESSION_PTR session) {
+    auto origin = reinterpret_cast<string*>(SSL_get_ex_data(ssl, originIndex));
+
+    if (origin != nullptr && SSL_SESSION_is_resumable(session)) {
+        upstreamSessions.Put(*origin, session);
     }
 
-    return s;
+    // the cache took its own reference
+    return 0;
 }
 
 bool SslClient::ConfigureSslContext(SSL_CTX_PTR ctx, const SslConfig& config) {
-    auto clientConfig = reinterpret_cast<const SslClientConfig&>(config);
-
     SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
 
+    // sessions are only kept by origin in upstreamSessions, the internal cache can not tell origins apart
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, NewSessionCb);
+
     return true;
 }
 
-std::unique_ptr<BackendSslLayer> SslClient::Connect() {
-    _socket = -1;
-    _ctx = nullptr;
+SSL_CTX_PTR SslClient::GetContext() {
+    std::call_once(contextOnce, [this] {
+        originIndex = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, FreeOrigin);
+        sharedContext = CreateSslContext(*_config);
+    });
 
-    if ((_ctx = CreateSslContext(*_config)) == nullptr || (_socket = CreateSocket()) <= 0) {
+    return sharedContext.Get();
+}
+
+std::unique_ptr<BackendSslLayer> SslClient::Connect(int32_t socket) {
+    SSL_CTX_PTR ctx = GetContext();
+    string origin = _config->serverIp + ":" + to_string(_config->serverPort);
+
+    if (ctx == nullptr || originIndex < 0) {
+        close(socket);
         return nullptr;
     }
 
-    DEF_SSL(ssl, SSL_new(_ctx));
-    SSL_set_fd(ssl, _socket);
-    SSL_set_tlsext_host_name(ssl, _config->serverIp.c_str());
+    DEF_SSL(ssl, SSL_new(ctx));
+    if (ssl == nullptr) {
+        LOG_ERROR("Unable to create SSL");
+        close(socket);
+        return nullptr;
+    }
 
-    auto bessl = std::make_unique<BackendSslLayer>(nullptr, std::move(ssl));
+    SSL_set_fd(ssl, socket);
+    SSL_set_tlsext_host_name(ssl, _config->serverIp.c_str());
+    SSL_set_ex_data(ssl, originIndex, new string(origin));
 
-    if (bessl->Connect()) {
-        LOG_TRACE("Connected to server " << _config->serverIp);
-        return bessl;
-    } else {
-        return nullptr;
+    SSL_SESSION_OPTR session = upstreamSessions.Get(origin);
+    if (session != nullptr) {
+        SSL_set_session(ssl, session);
     }
+
+    LOG_TRACE("Connecting to server " << _config->serverIp);
+
+    return std::make_unique<BackendSslLayer>(std::move(ssl));
 }
@@ -1,14 +1,12 @@
 #include "ssl/SslServer.h"
-#include "http/HttpMessage.h"
-#include "http/HttpMessageBuilder.h"
-#include "middleware/BackendSslLayer.h"
-#include "middleware/FrontendSslLayer.h"
-#include "middleware/HttpRewriteLayer.h"
-#include "middleware/LogHttpLayer.h"
+#include "core/MetricsEndpoint.h"
+#include "core/ProxyConnection.h"
 #include "ssl/SslClient.h"
 #include "utils/CertOps.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 #include "utils/ThreadPool.h"
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
 #include <cstdio>
@@ -16,193 +14,351 @@
 #include <iostream>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
-#include <regex>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 using namespace std;
 
+// Stop all the event loops once a stop signal is read from the signal descriptor, the server is cleaned up by
+// Start() when its loop returns
+class SslServer::SignalHandler : public EventHandler {
+  public:
+    explicit SignalHandler(SslServer& server) : _server(server) {}
+
+    void OnEvent(int32_t fd, uint32_t events) override {
+        struct signalfd_siginfo info;
+
+        while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+            LOG_INFO("Stopping server (" << strsignal(info.ssi_signo) << ")...");
+            _server._running = false;
+
+            for (auto& loop : _server._loops) {
+                loop->Stop();
+            }
+        }
+    }
+
+  private:
+    SslServer& _server;
+};
+
+// Accept all pending connections on a listening socket and hand them to the event loop
+class SslServer::Acceptor : public EventHandler {
+  public:
+    Acceptor(SslServer& server, EventLoop& loop, UpstreamPool& upstreamPool)
+        : _server(server), _loop(loop), _upstreamPool(upstreamPool) {}
+
+    void OnEvent(int32_t fd, uint32_t events) override {
+        for (;;) {
+            struct sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+
+            int client = accept4(fd, reinterpret_cast<struct sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_ERROR("Unable to accept (" << std::strerror(errno) << ")");
+                }
+
+                return;
+            }
+
+            auto accepted = std::chrono::steady_clock::now();
+
+            // create ssl object for the new client
+            DEF_SSL(ssl, SSL_new(_server._ctx));
+            if (!ssl) {
+                LOG_ERROR("Unable to create SSL object for socket " << client);
+                close(client);
+                continue;
+            }
+
+            SSL_set_fd(ssl, client);
+            LOG_TRACE("Create Ssl object " << ssl.Get() << " for socket " << client);
+
+            auto connection = std::make_shared<ProxyConnection>(_server, _loop, _upstreamPool, std::move(ssl));
+            Metrics::Count(Metrics::Counter::CONNECTIONS);
+            Metrics::RecordSince(Metrics::Stage::ACCEPT, accepted);
+            connection->Start();
+        }
+    }
+
+  private:
+    SslServer& _server;
+    EventLoop& _loop;
+    UpstreamPool& _upstreamPool;
+};
+
 SslServer::SslServer(std::unique_ptr<SslServerConfig> config)
-    : _config(std::move(config)), _threadPool(std::make_unique<ThreadPool>(10)), _running(false),
-      _ctx(nullptr, SSL_CTX_free), _socket(-1) {}
+    : _config(std::move(config)), _threadPool(std::make_unique<ThreadPool>(10)),
+      _certificateCache(std::make_unique<x509::CertificateCache>(_config->certificateCacheSize)),
+      _certificateAuthority(nullptr), _sessionCache(nullptr), _ticketKeys(nullptr), _resolver(nullptr),
+      _mintDomains(_config->mintDomains), _wildcardDomains(_config->wildcardDomains), _publicSuffixes(),
+      _certificateFetches(), _running(false), _ctx(nullptr, SSL_CTX_free), _loops(), _upstreamPools(), _threads(),
+      _sockets(), _stopSignals() {
+    sigemptyset(&_stopSignals);
+
+    if (_config->sessionCacheSize > 0) {
+        _sessionCache = std::make_unique<SessionCache>(_config->sessionCacheSize);
+    }
 
-int32_t SslServer::CreateSocket() {
+    if (_config->ticketKeyRotation.count() > 0) {
+        _ticketKeys = std::make_unique<TicketKeys>(_config->ticketKeyRotation);
+    }
+}
+
+int32_t SslServer::CreateSocket(const std::string& ip, int32_t port) {
     int s = 0, res = 0, opt = 1;
     struct sockaddr_in localAddr;
 
     memset(&localAddr, 0, sizeof(localAddr));
 
     localAddr.sin_family = AF_INET;
-    localAddr.sin_port = htons(_config->listenPort);
-    localAddr.sin_addr.s_addr = inet_addr(_config->listenIp.c_str());
+    localAddr.sin_port = htons(port);
+    localAddr.sin_addr.s_addr = inet_addr(ip.c_str());
 
-    s = res = socket(AF_INET, SOCK_STREAM, 0);
+    s = res = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (s < 0) {
         LOG_ERROR("Unable to create socket (" << std::strerror(errno) << ")");
         return res;
     }
 
+    // every event loop binds its own socket to the same address, the kernel balances connections between them
     if ((res = setsockopt(s, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<char*>(&opt), sizeof(opt))) < 0) {
         LOG_ERROR("Unable to set socket options (" << std::strerror(errno) << ")");
+        close(s);
         return res;
     }
 
     if ((res = bind(s, reinterpret_cast<struct sockaddr*>(&localAddr), sizeof(localAddr))) < 0) {
         LOG_ERROR("Unable to bind (" << std::strerror(errno) << ")");
+        close(s);
         return res;
     }
 
-    if ((res = listen(s, 1)) < 0) {
+    if ((res = listen(s, SOMAXCONN)) < 0) {
         LOG_ERROR("Unable to listen (" << std::strerror(errno) << ")");
+        close(s);
         return res;
     }
 
-    LOG_INFO("Listeining on " << _config->listenIp.c_str() << ":" << _config->listenPort << " for new connections...");
-
     return s;
 }
 
-X509_OPTR SslServer::FetchCertificate(const std::string& serverName, SSL_PTR ssl, int32_t port) {
-    std::string certificateFile = "./certs/" + serverName;
-    DEF_X509(res, nullptr);
+void SslServer::RenderMetrics(std::ostream& out) {
+    x509::CertificateCacheStats cache = _certificateCache->GetStats();
+
+    Metrics::Render(out);
+
+    out << "# HELP tls_proxy_certificate_cache_hits_total Certificates found in the in-memory cache\n";
+    out << "# TYPE tls_proxy_certificate_cache_hits_total counter\n";
+    out << "tls_proxy_certificate_cache_hits_total " << cache.hits << "\n";
+    out << "# HELP tls_proxy_certificate_cache_misses_total Certificates not found in the in-memory cache\n";
+    out << "# TYPE tls_proxy_certificate_cache_misses_total counter\n";
+    out << "tls_proxy_certificate_cache_misses_total " << cache.misses << "\n";
+    out << "# HELP tls_proxy_certificate_cache_evictions_total Certificates evicted from the in-memory cache\n";
+    out << "# TYPE tls_proxy_certificate_cache_evictions_total counter\n";
+    out << "tls_proxy_certificate_cache_evictions_total " << cache.evictions << "\n";
+    out << "# HELP tls_proxy_certificate_cache_entries Certificates in the in-memory cache\n";
+    out << "# TYPE tls_proxy_certificate_cache_entries gauge\n";
+    out << "tls_proxy_certificate_cache_entries " << cache.entries << "\n";
+    if (_resolver != nullptr) {
+        ResolverStats names = _resolver->GetStats();
+
+        out << "# HELP tls_proxy_resolver_hits_total Names found in the resolver cache\n";
+        out << "# TYPE tls_proxy_resolver_hits_total counter\n";
+        out << "tls_proxy_resolver_hits_total " << names.hits << "\n";
+        out << "# HELP tls_proxy_resolver_misses_total Names not found (or expired) in the resolver cache\n";
+        out << "# TYPE tls_proxy_resolver_misses_total counter\n";
+        out << "tls_proxy_resolver_misses_total " << names.misses << "\n";
+        out << "# HELP tls_proxy_resolver_entries Names in the resolver cache\n";
+        out << "# TYPE tls_proxy_resolver_entries gauge\n";
+        out << "tls_proxy_resolver_entries " << names.entries << "\n";
+    }
+    out << "# HELP tls_proxy_upstream_session_entries Sessions kept for resuming upstream connections\n";
+    out << "# TYPE tls_proxy_upstream_session_entries gauge\n";
+    out << "tls_proxy_upstream_session_entries " << SslClient::GetSessionStats().entries << "\n";
+    if (_sessionCache != nullptr) {
+        SessionCacheStats sessions = _sessionCache->GetStats();
+
+        out << "# HELP tls_proxy_session_cache_hits_total Sessions found in the session cache\n";
+        out << "# TYPE tls_proxy_session_cache_hits_total counter\n";
+        out << "tls_proxy_session_cache_hits_total " << sessions.hits << "\n";
+        out << "# HELP tls_proxy_session_cache_misses_total Sessions not found (or expired) in the session cache\n";
+        out << "# TYPE tls_proxy_session_cache_misses_total counter\n";
+        out << "tls_proxy_session_cache_misses_total " << sessions.misses << "\n";
+        out << "# HELP tls_proxy_session_cache_evictions_total Sessions evicted from the session cache\n";
+        out << "# TYPE tls_proxy_session_cache_evictions_total counter\n";
+        out << "tls_proxy_session_cache_evictions_total " << sessions.evictions << "\n";
+        out << "# HELP tls_proxy_session_cache_entries Sessions in the session cache\n";
+        out << "# TYPE tls_proxy_session_cache_entries gauge\n";
+        out << "tls_proxy_session_cache_entries " << sessions.entries << "\n";
+    }
+
+    out << "# HELP tls_proxy_thread_pool_queue_depth Tasks waiting for a thread of the thread pool\n";
+    out << "# TYPE tls_proxy_thread_pool_queue_depth gauge\n";
+    out << "tls_proxy_thread_pool_queue_depth " << _threadPool->QueueDepth() << "\n";
+}
 
-    auto localServer = reinterpret_cast<SslServer*>(SSL_get_ex_data(ssl, 0));
-    // dont want openssl to release SslServer*
-    SSL_set_ex_data(ssl, 0, nullptr);
+X509_OPTR SslServer::LookupCertificate(const std::string& serverName) {
+    std::string certificateFile = _config->certificatesDir + "/" + serverName;
+    DEF_X509(res, _certificateCache->Get(serverName).Pop());
 
-    if (localServer == nullptr) {
-        res = nullptr;
+    if (res != nullptr || _config->certificatesDir.empty() || access(certificateFile.c_str(), F_OK) == -1) {
         return res;
     }
 
-    auto conf = std::make_unique<SslClientConfig>();
-    conf->isServer = false;
-    conf->localIp = localServer->GetConfig().listenIp;
-    conf->serverIp = serverName;
-    conf->serverPort = port;
-    SslClient sclient(std::move(conf));
+    if ((res = x509::LoadPemCert(certificateFile)) != nullptr) {
+        _certificateCache->Put(serverName, res);
+    }
+
+    return res;
+}
 
-    // we want to connect either way, but clone the certificate only if its not
-    // present in the cache
-    auto bessl = sclient.Connect();
+X509_OPTR SslServer::GenerateCertificate(const std::string& serverName, X509_OPTR serverCertificate) {
+    DEF_X509(res, nullptr);
 
-    if (bessl == nullptr) {
-        res = nullptr;
+    if (serverCertificate == nullptr || (res = _certificateAuthority->Clone(serverCertificate)) == nullptr) {
         return res;
     }
 
-    if (access(certificateFile.c_str(), F_OK) != -1) {
-        res = x509::LoadPemCert(certificateFile);
-    } else {
-        if ((res = bessl->GetCertificate()) != nullptr &&
-            (res = x509::ClonePemCert(std::move(res), localServer->GetConfig().caCertificateFile,
-                                      localServer->GetConfig().keyFile)) != nullptr) {
-            std::string certFileName = "./certs/" + serverName;
-            x509::SaveCertificateToPemFile(res, certFileName);
-        }
+    StoreCertificate(serverName, res);
+
+    return res;
+}
+
+std::string SslServer::CertificateName(const std::string& serverName) const {
+    size_t dot = serverName.find('.');
+
+    if (!_wildcardDomains.Matches(serverName) || dot == std::string::npos) {
+        return serverName;
     }
 
-    auto lastHandelingLayer = reinterpret_cast<HandlerLayer*>(SSL_get_ex_data(ssl, 1));
-    // dont want openssl to release HandlerLayer*
-    SSL_set_ex_data(ssl, 1, nullptr);
-    if (lastHandelingLayer != nullptr) {
-        lastHandelingLayer->SetNext(std::move(bessl));
+    // a wildcard matches a single label, it can not be issued for a public suffix (e.g. "*.co.uk")
+    std::string parent = serverName.substr(dot + 1);
+    if (parent.empty() || _publicSuffixes.IsPublicSuffix(parent)) {
+        return serverName;
     }
 
-    return res;
+    return "*." + parent;
 }
 
-int32_t SslServer::ServerNameCb(SSL_PTR ssl, int* ad, void* arg) {
-    int* alreadyFetched = nullptr;
+X509_OPTR SslServer::MintCertificate(const std::string& certificateName) {
+    DEF_X509(res, _certificateAuthority->Mint(certificateName).Pop());
 
-    if (ssl == nullptr) {
-        return SSL_TLSEXT_ERR_NOACK;
+    if (res != nullptr) {
+        Metrics::Count(Metrics::Counter::MINTED_CERTIFICATES);
+        StoreCertificate(certificateName, res);
     }
 
-    if ((alreadyFetched = reinterpret_cast<int*>(SSL_get_ex_data(ssl, 2))) != nullptr) {
-        delete alreadyFetched;
-        SSL_set_ex_data(ssl, 2, nullptr);
+    return res;
+}
 
-        return SSL_TLSEXT_ERR_NOACK;
+void SslServer::StoreCertificate(const std::string& serverName, X509_PTR certificate) {
+    if (!_config->certificatesDir.empty()) {
+        x509::SaveCertificateToPemFile(certificate, _config->certificatesDir + "/" + serverName);
     }
 
-    const char* servername = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
-    if (!servername || servername[0] == '\0') {
-        LOG_ERROR("No SNI");
-        return SSL_TLSEXT_ERR_NOACK;
-    }
+    _certificateCache->Put(serverName, certificate);
+}
 
-    LOG_TRACE("Got request with sni: " << servername);
-    std::string sni(servername);
+// Extract the host name from the server_name extension of the ClientHello
+static std::string GetClientHelloServerName(SSL_PTR ssl) {
+    const unsigned char* ext = nullptr;
+    size_t extLen = 0;
 
-    auto x509 = FetchCertificate(sni, ssl);
+    // server_name extension: list length (2), name type (1), name length (2), name
+    if (!SSL_client_hello_get0_ext(ssl, TLSEXT_TYPE_server_name, &ext, &extLen) || extLen < 5 ||
+        static_cast<size_t>((ext[0] << 8) | ext[1]) + 2 != extLen || ext[2] != TLSEXT_NAMETYPE_host_name) {
+        return "";
+    }
 
-    if (x509 == nullptr) {
-        LOG_ERROR("Failed to fetch certificate");
-        return SSL_TLSEXT_ERR_ALERT_FATAL;
-    } else if (SSL_use_certificate(ssl, x509) <= 0) {
-        LOG_ERROR("Failed to use certificate");
-        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    size_t nameLen = (ext[3] << 8) | ext[4];
+    if (nameLen + 5 > extLen) {
+        return "";
     }
 
-    return SSL_TLSEXT_ERR_OK;
+    return std::string(reinterpret_cast<const char*>(ext + 5), nameLen);
 }
 
-bool SslServer::HandleHttpConnect(int32_t clientSocket, SSL_PTR ssl) {
-    char content[1024];
-    int32_t bytes = 0;
-    bool res = true;
-
-    if ((bytes = recv(clientSocket, &content, sizeof(content) - 1, MSG_PEEK)) >= 0) {
-        content[bytes] = '\0';
-
-        try {
-            HttpMessage httpMessage(content);
-
-            if (httpMessage.IsRequest() && httpMessage.Method() == HttpMessage::HttpMethod::CONNECT &&
-                (bytes = recv(clientSocket, &content, sizeof(content) - 1, 0)) >= 0 &&
-                bytes == static_cast<int32_t>(httpMessage.OriginalMessage().size())) {
-                LOG_TRACE("Handling HTTP CONNECT");
-                auto x509 = FetchCertificate(httpMessage.Host(), ssl, httpMessage.Port());
-
-                if (x509 == nullptr) {
-                    LOG_ERROR("Failed to fetch certificate");
-                    res = false;
-                } else if (SSL_use_certificate(ssl, x509) <= 0) {
-                    LOG_ERROR("Failed to use certificate");
-                    res = false;
-                } else {
-                    HttpMessageBuilder msg(false);
-                    std::string& status = msg.Status();
-                    std::string httpReply;
-
-                    status = "200 Connection Established";
-                    msg.Headers()["host"] = httpMessage.Headers().find("host")->second;
-                    httpReply = msg.Build().ToString();
-
-                    write(clientSocket, httpReply.c_str(), httpReply.size());
-
-                    SSL_set_ex_data(ssl, 2, new int(1));
-                }
-            }
-        } catch (std::invalid_argument* e) {
-            LOG_TRACE("Not an HTTP Connect");
-        }
+int32_t SslServer::ClientHelloCb(SSL_PTR ssl, int* ad, void* arg) {
+    if (ssl == nullptr) {
+        return SSL_CLIENT_HELLO_ERROR;
     }
 
-    return res;
+    auto connection = reinterpret_cast<ProxyConnection*>(SSL_get_ex_data(ssl, 0));
+    if (connection == nullptr) {
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    return connection->OnClientHello(GetClientHelloServerName(ssl));
+}
+
+static std::string SessionId(SSL_SESSION_PTR session) {
+    unsigned int length = 0;
+    const unsigned char* id = SSL_SESSION_get_id(session, &length);
+
+    return std::string(reinterpret_cast<const char*>(id), length);
+}
+
+static SslServer* GetServer(SSL_CTX_PTR ctx) { return reinterpret_cast<SslServer*>(SSL_CTX_get_ex_data(ctx, 0)); }
+
+int SslServer::NewSessionCb(SSL_PTR ssl, SSL_SESSION_PTR session) {
+    GetServer(SSL_get_SSL_CTX(ssl))->_sessionCache->Put(SessionId(session), session);
+
+    // the cache took its own reference
+    return 0;
+}
+
+SSL_SESSION_PTR SslServer::GetSessionCb(SSL_PTR ssl, const unsigned char* id, int length, int* copy) {
+    std::string key(reinterpret_cast<const char*>(id), length);
+
+    // the reference of the lookup is handed to OpenSSL, another loop may evict the session from the cache
+    // before OpenSSL could take a reference of its own
+    *copy = 0;
+
+    return GetServer(SSL_get_SSL_CTX(ssl))->_sessionCache->Get(key).Pop();
+}
+
+void SslServer::RemoveSessionCb(SSL_CTX_PTR ctx, SSL_SESSION_PTR session) {
+    GetServer(ctx)->_sessionCache->Remove(SessionId(session));
+}
+
+int SslServer::TicketKeyCb(SSL_PTR ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher,
+                           HMAC_CTX* hmac, int encrypt) {
+    return GetServer(SSL_get_SSL_CTX(ssl))->_ticketKeys->Setup(name, iv, cipher, hmac, encrypt != 0);
 }
 
 bool SslServer::ConfigureSslContext(SSL_CTX_PTR ctx, const SslConfig& config) {
     auto serverConfig = reinterpret_cast<const SslServerConfig&>(config);
 
     SSL_CTX_set_ecdh_auto(ctx, 1);
+    SSL_CTX_set_client_hello_cb(ctx, ClientHelloCb, nullptr);
+    SSL_CTX_set_ex_data(ctx, 0, this);
+    SSL_CTX_set_timeout(ctx, serverConfig.sessionTimeout.count());
+
+    // sessions are kept in the sharded SessionCache instead of the internal cache of the context
+    if (_sessionCache != nullptr) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(ctx, NewSessionCb);
+        SSL_CTX_sess_set_get_cb(ctx, GetSessionCb);
+        SSL_CTX_sess_set_remove_cb(ctx, RemoveSessionCb);
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (_ticketKeys != nullptr) {
+        SSL_CTX_set_tlsext_ticket_key_cb(ctx, TicketKeyCb);
+    } else {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
 
     if (SSL_CTX_use_PrivateKey_file(ctx, serverConfig.keyFile.c_str(), SSL_FILETYPE_PEM) <= 0 ||
         SSL_CTX_set_cipher_list(ctx, serverConfig.cipherList.c_str()) <= 0 ||
-        SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS) <= 0 ||
-        SSL_CTX_set_tlsext_servername_callback(ctx, ServerNameCb) <= 0) {
+        SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS) <= 0) {
         LOG_ERROR("Failed to set OpenSsl Context options");
         ERR_print_errors_fp(stderr);
         return false;
@@ -211,64 +367,120 @@ bool SslServer::ConfigureSslContext(SSL_CTX_PTR ctx, const SslConfig& config) {
     return true;
 }
 
-// not even based on purpose
 void SslServer::Start() {
-    _socket = -1;
+    uint32_t numberOfWorkers = std::max(_config->numberOfWorkers, 1u);
     _ctx = nullptr;
 
-    if ((_ctx = CreateSslContext(*_config)) == nullptr || (_socket = CreateSocket()) <= 0) {
+    if ((_ctx = CreateSslContext(*_config)) == nullptr) {
         return;
     }
 
-    _running = true;
-    _threadPool->Start();
+    // load the CA and the generated certificates key once, they are used to sign every new certificate
+    _certificateAuthority = std::make_unique<x509::CertificateAuthority>(_config->caCertificateFile, _config->keyFile);
+    if (!_certificateAuthority->IsValid()) {
+        return;
+    }
 
-    /* Handle connections */
-    while (_running) {
-        struct sockaddr_in addr;
-        uint len = sizeof(addr);
+    if (!_config->accessLog.dir.empty() && !AccessLog::Open(_config->accessLog)) {
+        return;
+    }
 
-        int client = accept(_socket, reinterpret_cast<struct sockaddr*>(&addr), &len);
-        if (client < 0) {
-            LOG_ERROR("Unable to accept (" << std::strerror(errno) << ")");
+    if (_config->resolver.hostsFile.empty()) {
+        _resolver = std::make_unique<Resolver>(*_threadPool, std::make_unique<SystemNameSource>(), _config->resolver);
+    } else {
+        auto hostsFile = std::make_unique<HostsFileNameSource>(_config->resolver.hostsFile);
+
+        if (!hostsFile->Load()) {
             return;
         }
 
-        LOG_TRACE("Adding task to handle client socket " << client);
-        _threadPool->AddTask([this, client] {
-            // create ssl object got the new client
-            DEF_SSL(ssl, SSL_new(_ctx));
-            SSL_set_fd(ssl, client);
-            SSL_set_ex_data(ssl, 0, this);
+        _resolver = std::make_unique<Resolver>(*_threadPool, std::move(hostsFile), _config->resolver);
+    }
 
-            // build layers according to processing order
-            auto middlewareRewrite = std::make_unique<HttpRewriteLayer>(nullptr);
-            SSL_set_ex_data(ssl, 1, middlewareRewrite.get()); // do it now because after move this pointer is invalid
+    if (!_wildcardDomains.Empty() && !_publicSuffixes.Load(_config->publicSuffixFile)) {
+        return;
+    }
 
-            auto middlewareLogger = std::make_unique<LogHttpLayer>(std::move(middlewareRewrite));
+    for (uint32_t i = 0; i < numberOfWorkers; i++) {
+        int32_t s = CreateSocket(_config->listenIp, _config->listenPort);
 
-            if (HandleHttpConnect(client, ssl)) {
-                LOG_TRACE("Create Ssl object " << ssl.Get() << " for socket " << client);
+        if (s <= 0) {
+            Stop();
+            return;
+        }
 
-                FrontendSslLayer fssl(std::move(middlewareLogger), std::move(ssl));
+        _sockets.push_back(s);
+        _loops.push_back(std::make_unique<EventLoop>());
+        _upstreamPools.push_back(std::make_shared<UpstreamPool>(*_loops.back(), _config->upstreamPool));
+        _loops.back()->Add(s, std::make_shared<Acceptor>(*this, *_loops.back(), *_upstreamPools.back()));
+    }
 
-                LOG_TRACE("Starting to process messages");
-                auto res = fssl.ProcessMessage(std::make_shared<EmptyMessage>());
-            } else {
-                SSL_set_ex_data(ssl, 0, nullptr);
-                SSL_set_ex_data(ssl, 1, nullptr);
-                close(client);
-            }
-        });
+    if (_config->adminPort != 0) {
+        int32_t s = CreateSocket("127.0.0.1", _config->adminPort);
+
+        if (s <= 0) {
+            Stop();
+            return;
+        }
+
+        _sockets.push_back(s);
+        _loops[0]->Add(s, std::make_shared<MetricsEndpoint>(*_loops[0], [this](std::ostream& out) {
+            RenderMetrics(out);
+        }));
+        LOG_INFO("Serving metrics on 127.0.0.1:" << _config->adminPort << "/metrics");
     }
+
+    if (!sigisemptyset(&_stopSignals)) {
+        int32_t s = signalfd(-1, &_stopSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+        if (s < 0) {
+            LOG_ERROR("Unable to create signal descriptor (" << std::strerror(errno) << ")");
+            Stop();
+            return;
+        }
+
+        _sockets.push_back(s);
+        _loops[0]->Add(s, std::make_shared<SignalHandler>(*this));
+    }
+
+    LOG_INFO("Listeining on " << _config->listenIp.c_str() << ":" << _config->listenPort << " with "
+                              << numberOfWorkers << " workers for new connections...");
+
+    _running = true;
+    _threadPool->Start();
+
+    for (uint32_t i = 1; i < numberOfWorkers; i++) {
+        EventLoop* loop = _loops[i].get();
+        _threads.emplace_back([loop] { loop->Run(); });
+    }
+
+    // Handle connections
+    _loops[0]->Run();
+
+    // the loops were stopped (e.g. by a stop signal), wait for the other threads and release the server
+    Stop();
 }
 
 void SslServer::Stop() {
     _running = false;
 
+    for (auto& loop : _loops) {
+        loop->Stop();
+    }
+
+    // the first loop is run by the thread which called Start()
+    for (auto& t : _threads) {
+        if (t.joinable() && t.get_id() != std::this_thread::get_id()) {
+            t.join();
+        }
+    }
+
     _threadPool->Stop();
 
-    close(_socket);
-    _socket = -1;
+    for (auto s : _sockets) {
+        close(s);
+    }
+
+    _sockets.clear();
     _ctx = nullptr;
 }
@@ -0,0 +1,299 @@
+#include "utils/AccessLog.h"
+#include "utils/Logger.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+constexpr char AccessLog::MAGIC[4];
+constexpr uint32_t AccessLog::VERSION;
+
+constexpr size_t HEADER_SIZE = sizeof(AccessLog::MAGIC) + sizeof(uint32_t);
+constexpr size_t MAX_VARINT_SIZE = 10;
+constexpr size_t MAX_STRING_SIZE = 2048; // longer host names and paths are cut
+
+bool AccessLog::_isEnabled = false;
+static AccessLogConfig accessLogConfig;
+static time_t accessLogStart = 0;
+static atomic<uint32_t> nextWriter(0);
+
+static uint64_t HashString(StringView s) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c : s) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static size_t PutVarint(char* out, uint64_t value) {
+    size_t size = 0;
+
+    while (value >= 0x80) {
+        out[size++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+
+    out[size++] = static_cast<char>(value);
+    return size;
+}
+
+// Writes the records of a single thread to segments of its own, so writing needs no locking
+class SegmentWriter {
+  public:
+    explicit SegmentWriter(uint32_t index)
+        : _index(index), _sequence(0), _fd(-1), _data(nullptr), _offset(0), _isFailed(false), _segments(),
+          _dictionary(), _strings() {}
+    ~SegmentWriter() { CloseSegment(); }
+
+    void Write(AccessRecord& record, StringView host, StringView path) {
+        host = host.substr(0, MAX_STRING_SIZE);
+        path = path.substr(0, MAX_STRING_SIZE);
+
+        // room for the record and for both strings in case they are not in the segment yet
+        size_t size = 2 * (1 + MAX_VARINT_SIZE) + host.size() + path.size() + 1 + sizeof(AccessRecord);
+
+        if (_data == nullptr || _offset + size > accessLogConfig.segmentSize) {
+            CloseSegment();
+
+            if (!OpenSegment()) {
+                return;
+            }
+        }
+
+        record.hostId = StringId(host);
+        record.pathId = StringId(path);
+        Put(AccessLog::RECORD, &record, sizeof(record));
+    }
+
+  private:
+    bool OpenSegment() {
+        char name[64];
+
+        snprintf(name, sizeof(name), "/access-%ld-%u-%06lu.bin", static_cast<long>(accessLogStart), _index,
+                 static_cast<unsigned long>(_sequence++));
+
+        std::string file = accessLogConfig.dir + name;
+        _fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (_fd < 0 || ftruncate(_fd, accessLogConfig.segmentSize) < 0 ||
+            (_data = static_cast<char*>(mmap(nullptr, accessLogConfig.segmentSize, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED, _fd, 0))) == MAP_FAILED) {
+            // reported once, the next records try again
+            if (!_isFailed) {
+                LOG_ERROR("Unable to create access log segment " << file << " (" << strerror(errno) << ")");
+                _isFailed = true;
+            }
+
+            if (_fd >= 0) {
+                close(_fd);
+            }
+
+            _fd = -1;
+            _data = nullptr;
+            return false;
+        }
+
+        memcpy(_data, AccessLog::MAGIC, sizeof(AccessLog::MAGIC));
+        memcpy(_data + sizeof(AccessLog::MAGIC), &AccessLog::VERSION, sizeof(uint32_t));
+        _offset = HEADER_SIZE;
+        _isFailed = false;
+        _dictionary.clear();
+        _strings.clear();
+
+        // rotate, the oldest segments of the writer are removed
+        _segments.push_back(file);
+
+        while (_segments.size() > accessLogConfig.maxSegments) {
+            unlink(_segments.front().c_str());
+            _segments.pop_front();
+        }
+
+        return true;
+    }
+
+    void CloseSegment() {
+        if (_data == nullptr) {
+            return;
+        }
+
+        munmap(_data, accessLogConfig.segmentSize);
+
+        // the unused end of the segment is not kept
+        if (ftruncate(_fd, _offset) < 0) {
+            LOG_ERROR("Unable to truncate access log segment (" << strerror(errno) << ")");
+        }
+
+        close(_fd);
+        _fd = -1;
+        _data = nullptr;
+    }
+
+    // Return the id of s in the segment, it is added to the segment if it is not there yet
+    uint32_t StringId(StringView s) {
+        uint64_t hash = HashString(s);
+        auto entry = _dictionary.find(hash);
+
+        if (entry != _dictionary.end() && _strings[entry->second] == s) {
+            return entry->second;
+        }
+
+        char header[MAX_VARINT_SIZE];
+        size_t headerSize = PutVarint(header, s.size());
+        auto id = static_cast<uint32_t>(_strings.size());
+
+        memcpy(_data + _offset + 1, header, headerSize);
+        Put(AccessLog::STRING, s.data(), s.size(), headerSize);
+        _strings.push_back(StringView(_data + _offset - s.size(), s.size()));
+        _dictionary[hash] = id;
+
+        return id;
+    }
+
+    // Write an entry of size bytes (after prefixSize bytes which were already written after the type byte).
+    // The type is written last, a reader of a live segment does not see a partially written entry
+    void Put(AccessLog::EntryType type, const void* data, size_t size, size_t prefixSize = 0) {
+        char* entry = _data + _offset;
+
+        memcpy(entry + 1 + prefixSize, data, size);
+        atomic_thread_fence(memory_order_release);
+        entry[0] = static_cast<char>(type);
+        _offset += 1 + prefixSize + size;
+    }
+
+    uint32_t _index;
+    uint64_t _sequence;
+    int32_t _fd;
+    char* _data;
+    size_t _offset;
+    bool _isFailed;
+    deque<std::string> _segments;
+    unordered_map<uint64_t, uint32_t> _dictionary; // hash of a string to its id
+    vector<StringView> _strings;                   // views into the segment
+};
+
+bool AccessLog::Open(const AccessLogConfig& config) {
+    if (mkdir(config.dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        LOG_ERROR("Unable to create access log directory " << config.dir << " (" << strerror(errno) << ")");
+        return false;
+    }
+
+    accessLogConfig = config;
+    accessLogConfig.maxSegments = max<size_t>(accessLogConfig.maxSegments, 1);
+    // a segment always fits a record with the longest strings
+    accessLogConfig.segmentSize = max(accessLogConfig.segmentSize, HEADER_SIZE + 2 * (1 + MAX_VARINT_SIZE) +
+                                                                       2 * MAX_STRING_SIZE + 1 + sizeof(AccessRecord));
+    accessLogStart = time(nullptr);
+    _isEnabled = true;
+
+    return true;
+}
+
+void AccessLog::Write(AccessRecord& record, StringView host, StringView path) {
+    static thread_local unique_ptr<SegmentWriter> writer = nullptr;
+
+    if (writer == nullptr) {
+        writer = make_unique<SegmentWriter>(nextWriter++);
+    }
+
+    writer->Write(record, host, path);
+}
+
+AccessLogReader::AccessLogReader(const std::string& file) : _data(nullptr), _size(0), _offset(0), _strings() {
+    struct stat info;
+    int32_t fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return;
+    }
+
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= HEADER_SIZE) {
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data != MAP_FAILED) {
+            _data = static_cast<const char*>(data);
+            _size = info.st_size;
+        }
+    }
+
+    close(fd);
+
+    uint32_t version = 0;
+
+    if (_data != nullptr) {
+        memcpy(&version, _data + sizeof(AccessLog::MAGIC), sizeof(version));
+    }
+
+    if (_data != nullptr && (memcmp(_data, AccessLog::MAGIC, sizeof(AccessLog::MAGIC)) != 0 ||
+                             version != AccessLog::VERSION)) {
+        munmap(const_cast<char*>(_data), _size);
+        _data = nullptr;
+    }
+
+    _offset = HEADER_SIZE;
+}
+
+AccessLogReader::~AccessLogReader() {
+    if (_data != nullptr) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+bool AccessLogReader::ReadVarint(uint64_t& value) {
+    value = 0;
+
+    for (size_t shift = 0; _offset < _size && shift < 64; shift += 7) {
+        auto byte = static_cast<uint8_t>(_data[_offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AccessLogReader::Next(AccessRecord& record) {
+    uint64_t size = 0;
+
+    while (_data != nullptr && _offset < _size) {
+        switch (static_cast<AccessLog::EntryType>(_data[_offset++])) {
+        case AccessLog::STRING:
+            if (!ReadVarint(size) || size > _size - _offset) {
+                return false;
+            }
+
+            _strings.push_back(StringView(_data + _offset, size));
+            _offset += size;
+            break;
+        case AccessLog::RECORD:
+            if (sizeof(record) > _size - _offset) {
+                return false;
+            }
+
+            memcpy(&record, _data + _offset, sizeof(record));
+            _offset += sizeof(record);
+            return true;
+        default:
+            // END, or a segment which was not closed
+            return false;
+        }
+    }
+
+    return false;
+}
+
+StringView AccessLogReader::String(uint32_t id) const { return id < _strings.size() ? _strings[id] : StringView(); }
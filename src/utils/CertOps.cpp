@@ -1,10 +1,15 @@
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <openssl/bio.h>
 #include <openssl/pem.h>
 #include <openssl/x509v3.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "utils/CertOps.h"
+#include "utils/CertificateAuthority.h"
 
 using namespace std;
 
@@ -35,10 +40,35 @@ X509_OPTR LoadPemCert(const string& file) {
 }
 
 int SaveCertificateToPemFile(X509_PTR certificate, const string& certFile) {
-    FileHandle file{certFile, "w+"};
-    DEF_BIO(outputFile, BIO_new_fp(file, BIO_NOCLOSE));
+    // write to a private temporary file and rename it, readers never see a partially written certificate.
+    // mkstemp makes the name unique, the threads of the proxy may save the same certificate concurrently.
+    string tmpFile = certFile + ".tmp.XXXXXX";
+    int res = 0;
+    int fd = mkstemp(&tmpFile[0]);
+
+    if (fd < 0) {
+        return res;
+    }
+
+    // mkstemp creates the file readable by the owner only, keep the permissions of a regular file
+    fchmod(fd, 0644);
+
+    {
+        FileHandle file{fdopen(fd, "w+")};
+        if (file == nullptr) {
+            close(fd);
+            unlink(tmpFile.c_str());
+            return res;
+        }
 
-    int res = PEM_write_bio_X509(outputFile, certificate);
+        DEF_BIO(outputFile, BIO_new_fp(file, BIO_NOCLOSE));
+        res = PEM_write_bio_X509(outputFile, certificate);
+    }
+
+    if (res <= 0 || rename(tmpFile.c_str(), certFile.c_str()) != 0) {
+        unlink(tmpFile.c_str());
+        return 0;
+    }
 
     return res;
 }
@@ -53,32 +83,9 @@ int SaveKeyToPemFile(EVP_PKEY_PTR key, const string& keyFile) {
 }
 
 X509_OPTR ClonePemCert(X509_OPTR cert, const string& caFile, const string& keyFile) {
-    DEF_X509(caCert, LoadPemCert(caFile).Pop());
-    DEF_X509(newCert, X509_new());
-    DEF_EVP_PKEY(privateKey, LoadPemKey(keyFile, "").Pop());
-    DEF_EVP_PKEY(caPrivateKey, LoadPemKey(caFile, "").Pop());
-
-    X509_EXTENSION* ext = nullptr;
-    int extIndex = -1;
-
-    // Copy only relevant fields, not all of them
-    // Copy all fields may cause issues - an example - copy AuthorityInformationAccess extension will lead for browser
-    // to try and verify our generated certificate which will cause connection drop
-    if (!X509_set_pubkey(newCert, privateKey) || !X509_set_serialNumber(newCert, X509_get_serialNumber(cert)) ||
-        !X509_set_version(newCert, X509_get_version(cert)) ||
-        !X509_set_issuer_name(newCert, X509_get_subject_name(caCert)) ||
-        !X509_set_subject_name(newCert, X509_get_subject_name(cert)) ||
-        !X509_set1_notBefore(newCert, X509_get_notBefore(cert)) ||
-        !X509_set1_notAfter(newCert, X509_get_notAfter(cert)) ||
-        !(((extIndex = X509_get_ext_by_NID(cert, NID_subject_alt_name, -1)) >= 0 &&
-           (ext = X509_get_ext(cert, extIndex)) != nullptr && X509_add_ext(newCert, ext, -1)) ||
-          (extIndex < 0)) ||
-        !X509_sign(newCert, caPrivateKey, EVP_sha512()) || X509_check_issued(caCert, newCert) != X509_V_OK) {
-        cerr << "Failed to generate new certificate" << endl;
-        newCert = nullptr;
-    }
+    CertificateAuthority ca(caFile, keyFile);
 
-    return newCert;
+    return ca.Clone(cert);
 }
 
 X509_OPTR ClonePemCert(const string& certFile, const string& caFile, const string& keyFile) {
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "utils/CertOps.h"
+#include "utils/CertificateAuthority.h"
+#include "utils/Logger.h"
+
+using namespace std;
+
+namespace x509 {
+
+constexpr long CertificateAuthority::MINT_VALIDITY_DAYS;
+
+// the longest common name allowed by RFC 5280 (ub-common-name)
+constexpr size_t MAX_COMMON_NAME = 64;
+
+// A name which can be put in a subjectAltName as is, other characters (e.g. ',') could inject more names
+static bool IsValidDnsName(const string& host) {
+    return !host.empty() && host.size() <= 253 && host.front() != '.' && host.back() != '.' &&
+           all_of(host.begin(), host.end(),
+                  [](unsigned char c) { return isalnum(c) || c == '-' || c == '.' || c == '_'; });
+}
+
+static bool IsIpAddress(const string& host) {
+    unsigned char address[sizeof(struct in6_addr)];
+
+    return inet_pton(AF_INET, host.c_str(), address) == 1 || inet_pton(AF_INET6, host.c_str(), address) == 1;
+}
+
+CertificateAuthority::CertificateAuthority(const string& caFile, const string& keyFile)
+    : _caCert(LoadPemCert(caFile)), _caKey(LoadPemKey(caFile, "")), _key(LoadPemKey(keyFile, "")),
+      _templateDer("") {
+    DEF_X509(certTemplate, X509_new());
+    unsigned char* der = nullptr;
+    int derLen = 0;
+
+    if (!_caCert || !_caKey || !_key) {
+        LOG_ERROR("Failed to load CA certificate and keys from " << caFile << " and " << keyFile);
+        return;
+    }
+
+    // Fields which are the same for all the generated certificates.
+    // The per host fields get placeholder values and the template is signed only so it can be encoded,
+    // every generated certificate overrides them and is signed again
+    if (!certTemplate || !X509_set_version(certTemplate, 2) ||
+        !X509_set_issuer_name(certTemplate, X509_get_subject_name(_caCert)) ||
+        !X509_set_pubkey(certTemplate, _key) || !ASN1_INTEGER_set(X509_get_serialNumber(certTemplate), 1) ||
+        !X509_gmtime_adj(X509_getm_notBefore(certTemplate), 0) ||
+        !X509_gmtime_adj(X509_getm_notAfter(certTemplate), 0) || !X509_sign(certTemplate, _caKey, EVP_sha512()) ||
+        (derLen = i2d_X509(certTemplate, &der)) <= 0) {
+        LOG_ERROR("Failed to create certificate template");
+        return;
+    }
+
+    _templateDer.assign(reinterpret_cast<const char*>(der), derLen);
+    OPENSSL_free(der);
+}
+
+X509_OPTR CertificateAuthority::NewFromTemplate() {
+    auto der = reinterpret_cast<const unsigned char*>(_templateDer.data());
+    DEF_X509(res, d2i_X509(nullptr, &der, _templateDer.size()));
+
+    return res;
+}
+
+bool CertificateAuthority::Sign(X509_PTR cert) {
+    return X509_sign(cert, _caKey, EVP_sha512()) > 0 && X509_check_issued(_caCert, cert) == X509_V_OK;
+}
+
+X509_OPTR CertificateAuthority::Clone(X509_PTR cert) {
+    DEF_X509(newCert, nullptr);
+    X509_EXTENSION* ext = nullptr;
+    int extIndex = -1;
+
+    if (!IsValid() || cert == nullptr || (newCert = NewFromTemplate()) == nullptr) {
+        newCert = nullptr;
+        return newCert;
+    }
+
+    // Copy only relevant fields, not all of them
+    // Copy all fields may cause issues - an example - copy AuthorityInformationAccess extension will lead for browser
+    // to try and verify our generated certificate which will cause connection drop
+    if (!X509_set_serialNumber(newCert, X509_get_serialNumber(cert)) ||
+        !X509_set_subject_name(newCert, X509_get_subject_name(cert)) ||
+        !X509_set1_notBefore(newCert, X509_get_notBefore(cert)) ||
+        !X509_set1_notAfter(newCert, X509_get_notAfter(cert)) ||
+        !(((extIndex = X509_get_ext_by_NID(cert, NID_subject_alt_name, -1)) >= 0 &&
+           (ext = X509_get_ext(cert, extIndex)) != nullptr && X509_add_ext(newCert, ext, -1)) ||
+          (extIndex < 0)) ||
+        !Sign(newCert)) {
+        LOG_ERROR("Failed to generate new certificate");
+        newCert = nullptr;
+    }
+
+    return newCert;
+}
+
+X509_OPTR CertificateAuthority::Mint(const string& host) {
+    DEF_X509(newCert, nullptr);
+    bool isIp = IsIpAddress(host);
+    bool isWildcard = host.compare(0, 2, "*.") == 0;
+    string name = isWildcard ? host.substr(2) : host;
+    string altName = (isIp ? "IP:" : "DNS:") + host;
+    BIGNUM* serial = BN_new();
+    X509_EXTENSION* ext = nullptr;
+    X509_NAME* subject = nullptr;
+
+    // a wildcard certificate also covers its parent name, a wildcard matches a single label only
+    if (isWildcard) {
+        altName += ",DNS:" + name;
+    }
+
+    if (!IsValid() || (!isIp && !IsValidDnsName(name)) || (isWildcard && name.find('.') == string::npos) ||
+        (newCert = NewFromTemplate()) == nullptr || serial == nullptr) {
+        LOG_ERROR("Unable to mint a certificate for " << host);
+        BN_free(serial);
+        newCert = nullptr;
+        return newCert;
+    }
+
+    // a random positive serial, minted certificates of the same host must not share it
+    subject = X509_get_subject_name(newCert);
+    if (!BN_rand(serial, 127, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY) ||
+        !BN_to_ASN1_INTEGER(serial, X509_get_serialNumber(newCert)) ||
+        (host.size() <= MAX_COMMON_NAME &&
+         !X509_NAME_add_entry_by_NID(subject, NID_commonName, MBSTRING_ASC,
+                                     reinterpret_cast<const unsigned char*>(host.c_str()), -1, -1, 0)) ||
+        !X509_gmtime_adj(X509_getm_notBefore(newCert), -3600) ||
+        !X509_time_adj_ex(X509_getm_notAfter(newCert), MINT_VALIDITY_DAYS, 0, nullptr) ||
+        (ext = X509V3_EXT_conf_nid(nullptr, nullptr, NID_subject_alt_name, altName.c_str())) == nullptr ||
+        !X509_add_ext(newCert, ext, -1) || !Sign(newCert)) {
+        LOG_ERROR("Failed to mint a certificate for " << host);
+        newCert = nullptr;
+    }
+
+    X509_EXTENSION_free(ext);
+    BN_free(serial);
+
+    return newCert;
+}
+}; // namespace x509
@@ -0,0 +1,83 @@
+#include <functional>
+#include <openssl/x509.h>
+
+#include "utils/CertificateCache.h"
+
+using namespace std;
+
+namespace x509 {
+
+constexpr size_t CertificateCache::NUMBER_OF_SHARDS;
+
+CertificateCache::CertificateCache(size_t maxEntries)
+    : _shards(), _maxEntriesPerShard(max<size_t>(1, (maxEntries + NUMBER_OF_SHARDS - 1) / NUMBER_OF_SHARDS)) {}
+
+CertificateCache::Shard& CertificateCache::GetShard(const string& host) {
+    return _shards[hash<string>()(host) % NUMBER_OF_SHARDS];
+}
+
+X509_OPTR CertificateCache::Get(const string& host) {
+    DEF_X509(res, nullptr);
+    Shard& shard = GetShard(host);
+    unique_lock<mutex> l(shard.lock);
+
+    auto it = shard.index.find(host);
+    if (it == shard.index.end()) {
+        shard.misses++;
+        return res;
+    }
+
+    shard.hits++;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+    X509_PTR certificate = it->second->second.Get();
+    X509_up_ref(certificate);
+    res = certificate;
+
+    return res;
+}
+
+void CertificateCache::Put(const string& host, X509_PTR certificate) {
+    Shard& shard = GetShard(host);
+
+    if (certificate == nullptr) {
+        return;
+    }
+
+    X509_up_ref(certificate);
+    DEF_X509(entry, certificate);
+
+    unique_lock<mutex> l(shard.lock);
+
+    auto it = shard.index.find(host);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(entry);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.emplace_front(host, std::move(entry));
+    shard.index.emplace(host, shard.lru.begin());
+
+    while (shard.lru.size() > _maxEntriesPerShard) {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+}
+
+CertificateCacheStats CertificateCache::GetStats() {
+    CertificateCacheStats stats{0, 0, 0, 0};
+
+    for (auto& shard : _shards) {
+        unique_lock<mutex> l(shard.lock);
+
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.lru.size();
+    }
+
+    return stats;
+}
+}; // namespace x509
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+#include "utils/DomainPatterns.h"
+
+using namespace std;
+
+static string Lower(const string& s) {
+    string res(s);
+
+    transform(res.begin(), res.end(), res.begin(), [](unsigned char c) { return tolower(c); });
+    return res;
+}
+
+DomainPatterns::DomainPatterns(const vector<string>& patterns) : DomainPatterns() {
+    for (const auto& pattern : patterns) {
+        Add(pattern);
+    }
+}
+
+void DomainPatterns::Add(const string& pattern) {
+    string p = Lower(pattern);
+
+    if (p == "*") {
+        _all = true;
+    } else if (p.size() > 2 && p.compare(0, 2, "*.") == 0) {
+        _suffixes.insert(p.substr(1));
+    } else if (!p.empty()) {
+        _names.insert(p);
+    }
+}
+
+bool DomainPatterns::Matches(const string& name) const {
+    string n = Lower(name);
+
+    if (_all || _names.count(n) > 0) {
+        return true;
+    }
+
+    // every parent of the name, e.g. ".b.example.com" and ".example.com" for "a.b.example.com"
+    for (size_t dot = n.find('.'); dot != string::npos; dot = n.find('.', dot + 1)) {
+        if (_suffixes.count(n.substr(dot)) > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+vector<string> DomainPatterns::Split(const string& list) {
+    vector<string> res;
+    istringstream stream(list);
+    string pattern;
+
+    while (getline(stream, pattern, ',')) {
+        pattern.erase(remove_if(pattern.begin(), pattern.end(), [](unsigned char c) { return isspace(c); }),
+                      pattern.end());
+
+        if (!pattern.empty()) {
+            res.push_back(pattern);
+        }
+    }
+
+    return res;
+}
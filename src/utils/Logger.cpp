@@ -0,0 +1,255 @@
+#include "utils/Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <streambuf>
+#include <unistd.h>
+
+using namespace std;
+
+// Must be a power of 2
+constexpr size_t RING_SIZE = 1 << 20;
+constexpr auto WRITER_IDLE_WAIT = chrono::milliseconds(5);
+
+// A single producer, single consumer ring of bytes.
+// The thread which owns the ring appends whole lines and publishes them by moving the head, the writer thread
+// takes everything up to the head and moves the tail, a line is never seen partially written.
+class Logger::Ring {
+  public:
+    Ring() : _data(new char[RING_SIZE]), _head(0), _tail(0), _isClosed(false) {}
+
+    bool Push(const char* data, size_t size) {
+        size_t head = _head.load(memory_order_relaxed);
+        size_t tail = _tail.load(memory_order_acquire);
+
+        if (RING_SIZE - (head - tail) < size) {
+            return false;
+        }
+
+        size_t offset = head & (RING_SIZE - 1);
+        size_t first = min(size, RING_SIZE - offset);
+
+        memcpy(_data.get() + offset, data, first);
+        memcpy(_data.get(), data + first, size - first);
+        _head.store(head + size, memory_order_release);
+
+        return true;
+    }
+
+    // Append all the published data to out
+    bool Pop(string& out) {
+        size_t tail = _tail.load(memory_order_relaxed);
+        size_t head = _head.load(memory_order_acquire);
+        size_t size = head - tail;
+
+        if (size == 0) {
+            return false;
+        }
+
+        size_t offset = tail & (RING_SIZE - 1);
+        size_t first = min(size, RING_SIZE - offset);
+
+        out.append(_data.get() + offset, first);
+        out.append(_data.get(), size - first);
+        _tail.store(head, memory_order_release);
+
+        return true;
+    }
+
+    // The owning thread exited, the ring is removed once it was drained
+    inline void Close() { _isClosed.store(true, memory_order_release); }
+    inline bool IsClosed() const { return _isClosed.load(memory_order_acquire); }
+
+  private:
+    unique_ptr<char[]> _data;
+    alignas(64) atomic<size_t> _head; // written by the owning thread
+    alignas(64) atomic<size_t> _tail; // written by the writer thread
+    atomic<bool> _isClosed;
+};
+
+// Appends to a string which keeps its capacity between lines
+class LogBuffer : public streambuf {
+  public:
+    string data;
+
+  protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            data.push_back(traits_type::to_char_type(c));
+        }
+
+        return c;
+    }
+
+    streamsize xsputn(const char* s, streamsize n) override {
+        data.append(s, n);
+        return n;
+    }
+};
+
+// The logging state of a thread
+struct ThreadLog {
+    ThreadLog() : buffer(), stream(&buffer), isBusy(false), ring(nullptr) {}
+    ~ThreadLog() {
+        if (ring != nullptr) {
+            ring->Close();
+        }
+    }
+
+    LogBuffer buffer;
+    ostream stream;
+    bool isBusy;
+    shared_ptr<Logger::Ring> ring;
+    time_t timestampTime = -1;
+    char timestamp[32] = {};
+};
+
+static thread_local ThreadLog threadLog;
+
+Logger& Logger::Instance() {
+    // never destroyed, threads may still log while the process exits
+    static Logger* logger = [] {
+        auto res = new Logger();
+        atexit([] { Logger::Instance().Stop(); });
+        return res;
+    }();
+
+    return *logger;
+}
+
+Logger::Logger()
+    : _lock(), _wakeup(), _rings(), _isStopped(false), _now(time(nullptr)), _dropped(0), _reportedDropped(0),
+      _writer() {
+    _writer = thread(&Logger::Run, this);
+}
+
+Logger::Ring& Logger::ThreadRing() {
+    if (threadLog.ring == nullptr) {
+        threadLog.ring = make_shared<Ring>();
+
+        lock_guard<mutex> guard(_lock);
+        _rings.push_back(threadLog.ring);
+    }
+
+    return *threadLog.ring;
+}
+
+bool Logger::Write(const char* data, size_t size) {
+    if (!ThreadRing().Push(data, size)) {
+        _dropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+const char* Logger::Timestamp() {
+    time_t now = Now();
+
+    if (threadLog.timestampTime != now) {
+        struct tm local;
+
+        localtime_r(&now, &local);
+        strftime(threadLog.timestamp, sizeof(threadLog.timestamp), "%T %F", &local);
+        threadLog.timestampTime = now;
+    }
+
+    return threadLog.timestamp;
+}
+
+bool Logger::Drain(string& batch) {
+    bool hasData = false;
+    lock_guard<mutex> guard(_lock);
+
+    for (auto ring = _rings.begin(); ring != _rings.end();) {
+        // a closed ring gets no more data once its last lines were taken
+        bool isClosed = (*ring)->IsClosed();
+
+        hasData = (*ring)->Pop(batch) || hasData;
+        ring = isClosed ? _rings.erase(ring) : ring + 1;
+    }
+
+    uint64_t dropped = Dropped();
+
+    if (dropped != _reportedDropped) {
+        batch += "[Error] [Logger] " + to_string(dropped - _reportedDropped) + " log lines were dropped\n";
+        _reportedDropped = dropped;
+        hasData = true;
+    }
+
+    return hasData;
+}
+
+void Logger::Output(const string& batch) {
+    size_t offset = 0;
+
+    while (offset < batch.size()) {
+        ssize_t bytes = write(STDOUT_FILENO, batch.data() + offset, batch.size() - offset);
+
+        if (bytes < 0 && errno != EINTR) {
+            return;
+        }
+
+        offset += max<ssize_t>(bytes, 0);
+    }
+}
+
+void Logger::Run() {
+    string batch;
+
+    while (true) {
+        _now.store(time(nullptr), memory_order_relaxed);
+        batch.clear();
+
+        if (Drain(batch)) {
+            Output(batch);
+            continue;
+        }
+
+        unique_lock<mutex> guard(_lock);
+
+        if (_isStopped) {
+            break;
+        }
+
+        _wakeup.wait_for(guard, WRITER_IDLE_WAIT);
+    }
+}
+
+void Logger::Stop() {
+    {
+        lock_guard<mutex> guard(_lock);
+
+        if (_isStopped) {
+            return;
+        }
+
+        _isStopped = true;
+    }
+
+    _wakeup.notify_one();
+    _writer.join();
+}
+
+LogLine::LogLine() : _buffer(&threadLog.buffer), _stream(&threadLog.stream), _isNested(threadLog.isBusy) {
+    if (_isNested) {
+        _buffer = new LogBuffer();
+        _stream = new ostream(_buffer);
+    }
+
+    threadLog.isBusy = true;
+    _buffer->data.clear();
+}
+
+LogLine::~LogLine() {
+    Logger::Instance().Write(_buffer->data.data(), _buffer->data.size());
+
+    if (_isNested) {
+        delete _stream;
+        delete _buffer;
+    } else {
+        threadLog.isBusy = false;
+    }
+}
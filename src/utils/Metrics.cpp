@@ -0,0 +1,210 @@
+#include "utils/Metrics.h"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Updated only by the thread which owns the slot, read by any thread
+struct Metrics::Slot {
+    atomic<uint64_t> counters[static_cast<size_t>(Counter::NUM_COUNTERS)] = {};
+    atomic<uint64_t> sslErrors[NUM_SSL_ERRORS] = {};
+    atomic<uint64_t> buckets[static_cast<size_t>(Stage::NUM_STAGES)][NUM_BUCKETS] = {};
+    atomic<uint64_t> sums[static_cast<size_t>(Stage::NUM_STAGES)] = {}; // microseconds
+};
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+};
+
+// In the order of Metrics::Stage
+static const char* const STAGES[] = {"accept",           "connect_peek",     "certificate_fetch",
+                                     "client_handshake", "request_head",     "upstream_connect",
+                                     "upstream_response", "response_transfer", "exchange"};
+
+// In the order of Metrics::Counter
+static const MetricInfo COUNTERS[] = {
+    {"tls_proxy_connections_total", "Accepted client connections"},
+    {"tls_proxy_closed_connections_total", "Closed client connections"},
+    {"tls_proxy_exchanges_total", "Exchanges (request and response) which were completed"},
+    {"tls_proxy_incomplete_exchanges_total", "Exchanges which ended before the response was complete"},
+    {"tls_proxy_upstream_handshakes_total", "New upstream connections"},
+    {"tls_proxy_upstream_resumed_total", "New upstream connections which resumed a session of their origin"},
+    {"tls_proxy_upstream_reused_total", "Requests sent on an idle upstream connection"},
+    {"tls_proxy_upstream_retries_total", "Requests sent again after a reused upstream connection was closed"},
+    {"tls_proxy_timeouts_total", "Upstream connects and exchanges aborted on a timeout"},
+    {"tls_proxy_full_handshakes_total", "Client handshakes which created a new session"},
+    {"tls_proxy_resumed_handshakes_total", "Client handshakes which resumed a session"},
+    {"tls_proxy_minted_certificates_total", "Certificates minted from the server name without the real server"}};
+
+// By value of the SSL_ERROR_* codes
+static const char* const SSL_ERRORS[] = {"SSL_ERROR_NONE",
+                                         "SSL_ERROR_SSL",
+                                         "SSL_ERROR_WANT_READ",
+                                         "SSL_ERROR_WANT_WRITE",
+                                         "SSL_ERROR_WANT_X509_LOOKUP",
+                                         "SSL_ERROR_SYSCALL",
+                                         "SSL_ERROR_ZERO_RETURN",
+                                         "SSL_ERROR_WANT_CONNECT",
+                                         "SSL_ERROR_WANT_ACCEPT",
+                                         "SSL_ERROR_WANT_ASYNC",
+                                         "SSL_ERROR_WANT_ASYNC_JOB",
+                                         "SSL_ERROR_WANT_CLIENT_HELLO_CB"};
+
+static_assert(sizeof(STAGES) / sizeof(STAGES[0]) == static_cast<size_t>(Metrics::Stage::NUM_STAGES),
+              "every stage needs a name");
+static_assert(sizeof(COUNTERS) / sizeof(COUNTERS[0]) == static_cast<size_t>(Metrics::Counter::NUM_COUNTERS),
+              "every counter needs a name");
+static_assert(sizeof(SSL_ERRORS) / sizeof(SSL_ERRORS[0]) == Metrics::NUM_SSL_ERRORS, "every error needs a name");
+
+// Slots are never removed, the counters of a thread which exited still count
+static mutex slotsLock;
+static vector<shared_ptr<Metrics::Slot>> slots;
+
+// Only the owning thread writes to a slot, a plain load and store is enough
+static inline void Add(atomic<uint64_t>& value, uint64_t n) {
+    value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+Metrics::Slot& Metrics::ThreadSlot() {
+    static thread_local Slot* slot = nullptr;
+
+    if (slot == nullptr) {
+        auto res = make_shared<Slot>();
+
+        lock_guard<mutex> guard(slotsLock);
+        slots.push_back(res);
+        slot = res.get();
+    }
+
+    return *slot;
+}
+
+void Metrics::Count(Counter counter, uint64_t value) {
+    Add(ThreadSlot().counters[static_cast<size_t>(counter)], value);
+}
+
+void Metrics::CountSslError(int32_t error) {
+    if (error >= 0 && static_cast<size_t>(error) < NUM_SSL_ERRORS) {
+        Add(ThreadSlot().sslErrors[error], 1);
+    }
+}
+
+void Metrics::Record(Stage stage, chrono::steady_clock::duration duration) {
+    Slot& slot = ThreadSlot();
+    auto value = max<int64_t>(chrono::duration_cast<chrono::microseconds>(duration).count(), 0);
+
+    Add(slot.buckets[static_cast<size_t>(stage)][BucketOf(value)], 1);
+    Add(slot.sums[static_cast<size_t>(stage)], value);
+}
+
+chrono::steady_clock::time_point Metrics::RecordSince(Stage stage, chrono::steady_clock::time_point start) {
+    auto now = chrono::steady_clock::now();
+
+    Record(stage, now - start);
+    return now;
+}
+
+size_t Metrics::BucketOf(uint64_t value) {
+    // the upper bounds are inclusive, as the le of a Prometheus bucket
+    value = value > 0 ? value - 1 : 0;
+
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    size_t exponent = 63 - __builtin_clzll(value);
+
+    if (exponent > MAX_EXPONENT) {
+        return NUM_BUCKETS - 1;
+    }
+
+    size_t sub = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+uint64_t Metrics::UpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket + 1;
+    } else if (bucket >= NUM_BUCKETS - 1) {
+        return numeric_limits<uint64_t>::max();
+    }
+
+    size_t exponent = (bucket - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+    size_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return static_cast<uint64_t>(SUB_BUCKETS + sub + 1) << (exponent - SUB_BUCKET_BITS);
+}
+
+void Metrics::Render(ostream& out) {
+    constexpr size_t NUM_STAGES = static_cast<size_t>(Stage::NUM_STAGES);
+    constexpr size_t NUM_COUNTERS = static_cast<size_t>(Counter::NUM_COUNTERS);
+
+    uint64_t counters[NUM_COUNTERS] = {};
+    uint64_t sslErrors[NUM_SSL_ERRORS] = {};
+    uint64_t buckets[NUM_STAGES][NUM_BUCKETS] = {};
+    uint64_t sums[NUM_STAGES] = {};
+
+    {
+        lock_guard<mutex> guard(slotsLock);
+
+        for (const auto& slot : slots) {
+            for (size_t i = 0; i < NUM_COUNTERS; i++) {
+                counters[i] += slot->counters[i].load(memory_order_relaxed);
+            }
+
+            for (size_t i = 0; i < NUM_SSL_ERRORS; i++) {
+                sslErrors[i] += slot->sslErrors[i].load(memory_order_relaxed);
+            }
+
+            for (size_t stage = 0; stage < NUM_STAGES; stage++) {
+                for (size_t i = 0; i < NUM_BUCKETS; i++) {
+                    buckets[stage][i] += slot->buckets[stage][i].load(memory_order_relaxed);
+                }
+
+                sums[stage] += slot->sums[stage].load(memory_order_relaxed);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+        out << "# HELP " << COUNTERS[i].name << " " << COUNTERS[i].help << "\n";
+        out << "# TYPE " << COUNTERS[i].name << " counter\n";
+        out << COUNTERS[i].name << " " << counters[i] << "\n";
+    }
+
+    out << "# HELP tls_proxy_ssl_errors_total Results of SSL_get_error by code\n";
+    out << "# TYPE tls_proxy_ssl_errors_total counter\n";
+
+    for (size_t i = 0; i < NUM_SSL_ERRORS; i++) {
+        out << "tls_proxy_ssl_errors_total{code=\"" << SSL_ERRORS[i] << "\"} " << sslErrors[i] << "\n";
+    }
+
+    out << "# HELP tls_proxy_stage_duration_seconds Time spent in every stage of a connection\n";
+    out << "# TYPE tls_proxy_stage_duration_seconds histogram\n";
+
+    for (size_t stage = 0; stage < NUM_STAGES; stage++) {
+        uint64_t count = 0;
+
+        for (size_t i = 0; i < NUM_BUCKETS; i++) {
+            count += buckets[stage][i];
+            out << "tls_proxy_stage_duration_seconds_bucket{stage=\"" << STAGES[stage] << "\",le=\"";
+
+            if (i == NUM_BUCKETS - 1) {
+                out << "+Inf";
+            } else {
+                out << UpperBound(i) / 1e6;
+            }
+
+            out << "\"} " << count << "\n";
+        }
+
+        out << "tls_proxy_stage_duration_seconds_sum{stage=\"" << STAGES[stage] << "\"} " << sums[stage] / 1e6
+            << "\n";
+        out << "tls_proxy_stage_duration_seconds_count{stage=\"" << STAGES[stage] << "\"} " << count << "\n";
+    }
+}
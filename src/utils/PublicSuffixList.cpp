@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "utils/Logger.h"
+#include "utils/PublicSuffixList.h"
+
+using namespace std;
+
+static string Lower(const string& s) {
+    string res(s);
+
+    transform(res.begin(), res.end(), res.begin(), [](unsigned char c) { return tolower(c); });
+    return res;
+}
+
+bool PublicSuffixList::Load(const string& path) {
+    ifstream file(path);
+    string line;
+
+    if (!file.is_open()) {
+        LOG_ERROR("Unable to read the public suffix list " << path);
+        return false;
+    }
+
+    _rules.clear();
+    _wildcards.clear();
+    _exceptions.clear();
+
+    while (getline(file, line)) {
+        istringstream fields(line);
+        string rule;
+
+        // a rule is the first word of its line, the rest of the line is ignored
+        if (!(fields >> rule) || rule.compare(0, 2, "//") == 0) {
+            continue;
+        }
+
+        rule = Lower(rule);
+
+        if (rule[0] == '!') {
+            _exceptions.insert(rule.substr(1));
+        } else if (rule.compare(0, 2, "*.") == 0) {
+            _wildcards.insert(rule.substr(2));
+        } else {
+            _rules.insert(rule);
+        }
+    }
+
+    LOG_INFO("Loaded " << _rules.size() + _wildcards.size() + _exceptions.size() << " public suffix rules from "
+                       << path);
+    return true;
+}
+
+bool PublicSuffixList::IsPublicSuffix(const string& name) const {
+    string n = Lower(name);
+    size_t dot = n.find('.');
+
+    if (_exceptions.count(n) > 0) {
+        return false;
+    }
+
+    return dot == string::npos || _rules.count(n) > 0 || _wildcards.count(n.substr(dot + 1)) > 0;
+}
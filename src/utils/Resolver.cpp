@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <netdb.h>
+#include <sstream>
+
+#include "utils/Logger.h"
+#include "utils/Resolver.h"
+#include "utils/ThreadPool.h"
+
+using namespace std;
+
+constexpr size_t Resolver::MAX_ENTRIES;
+
+// names are case insensitive
+static string NameOf(const string& host) {
+    string name(host);
+
+    transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+    return name;
+}
+
+bool SystemNameSource::Lookup(const string& host, addresses_t& addresses, chrono::seconds& ttl) {
+    struct addrinfo hints;
+    struct addrinfo* result = nullptr;
+    int res = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    // getaddrinfo is thread safe, unlike gethostbyname
+    if ((res = getaddrinfo(host.c_str(), nullptr, &hints, &result)) != 0 || result == nullptr) {
+        LOG_ERROR("No such host " << host << " (" << gai_strerror(res) << ")");
+        return false;
+    }
+
+    for (struct addrinfo* info = result; info != nullptr; info = info->ai_next) {
+        struct sockaddr_storage address;
+
+        memset(&address, 0, sizeof(address));
+        memcpy(&address, info->ai_addr, min<size_t>(info->ai_addrlen, sizeof(address)));
+        addresses.push_back(address);
+    }
+
+    freeaddrinfo(result);
+
+    return !addresses.empty();
+}
+
+bool HostsFileNameSource::Load() {
+    ifstream file(_path);
+    string line;
+
+    if (!file.is_open()) {
+        LOG_ERROR("Unable to read the hosts file " << _path);
+        return false;
+    }
+
+    _hosts.clear();
+
+    while (getline(file, line)) {
+        istringstream fields(line.substr(0, line.find('#')));
+        string ip, name;
+        struct sockaddr_storage address;
+
+        if (!(fields >> ip)) {
+            continue;
+        }
+
+        memset(&address, 0, sizeof(address));
+
+        auto v4 = reinterpret_cast<struct sockaddr_in*>(&address);
+        auto v6 = reinterpret_cast<struct sockaddr_in6*>(&address);
+
+        if (inet_pton(AF_INET, ip.c_str(), &v4->sin_addr) == 1) {
+            v4->sin_family = AF_INET;
+        } else if (inet_pton(AF_INET6, ip.c_str(), &v6->sin6_addr) == 1) {
+            v6->sin6_family = AF_INET6;
+        } else {
+            LOG_ERROR("Invalid address " << ip << " in the hosts file " << _path);
+            continue;
+        }
+
+        while (fields >> name) {
+            _hosts[NameOf(name)].push_back(address);
+        }
+    }
+
+    LOG_INFO("Resolving " << _hosts.size() << " names from " << _path);
+    return true;
+}
+
+bool HostsFileNameSource::Lookup(const string& host, addresses_t& addresses, chrono::seconds& ttl) {
+    auto it = _hosts.find(NameOf(host));
+
+    if (it == _hosts.end()) {
+        LOG_ERROR("No such host " << host << " in the hosts file " << _path);
+        return false;
+    }
+
+    addresses = it->second;
+    return true;
+}
+
+Resolver::Resolver(ThreadPool& threadPool, unique_ptr<NameSource> source, const ResolverConfig& config)
+    : _threadPool(threadPool), _source(std::move(source)), _config(config), _lock(), _cache(), _inFlight(),
+      _hits(0), _misses(0) {}
+
+bool Resolver::Lookup(const string& host, addresses_t& addresses) {
+    lock_guard<mutex> guard(_lock);
+
+    auto it = _cache.find(NameOf(host));
+    if (it == _cache.end()) {
+        _misses++;
+        return false;
+    }
+
+    if (it->second.expires <= chrono::steady_clock::now()) {
+        _cache.erase(it);
+        _misses++;
+        return false;
+    }
+
+    _hits++;
+    addresses = it->second.addresses;
+
+    return true;
+}
+
+void Resolver::Resolve(const string& host, const callback_t& callback) {
+    string name = NameOf(host);
+    lock_guard<mutex> guard(_lock);
+
+    auto it = _inFlight.find(name);
+    if (it != _inFlight.end()) {
+        it->second.push_back(callback);
+        return;
+    }
+
+    _inFlight[name].push_back(callback);
+    _threadPool.AddTask([this, name] { Complete(name); });
+}
+
+void Resolver::Prefetch(const string& host) {
+    string name = NameOf(host);
+    lock_guard<mutex> guard(_lock);
+
+    auto it = _cache.find(name);
+    if ((it != _cache.end() && it->second.expires > chrono::steady_clock::now()) ||
+        _inFlight.find(name) != _inFlight.end()) {
+        return;
+    }
+
+    _inFlight.emplace(name, vector<callback_t>());
+    _threadPool.AddTask([this, name] { Complete(name); });
+}
+
+void Resolver::Complete(const string& host) {
+    addresses_t addresses;
+    chrono::seconds ttl = _config.ttl;
+    vector<callback_t> callbacks;
+
+    if (!_source->Lookup(host, addresses, ttl)) {
+        addresses.clear();
+        ttl = _config.negativeTtl;
+    }
+
+    {
+        lock_guard<mutex> guard(_lock);
+        auto now = chrono::steady_clock::now();
+
+        if (ttl.count() > 0) {
+            // make room by dropping the expired names first
+            for (auto it = _cache.begin(); _cache.size() >= MAX_ENTRIES && it != _cache.end();) {
+                it = it->second.expires <= now ? _cache.erase(it) : next(it);
+            }
+
+            if (_cache.size() >= MAX_ENTRIES) {
+                _cache.erase(_cache.begin());
+            }
+
+            _cache[host] = Entry{addresses, now + ttl};
+        }
+
+        auto it = _inFlight.find(host);
+        if (it != _inFlight.end()) {
+            callbacks.swap(it->second);
+            _inFlight.erase(it);
+        }
+    }
+
+    for (auto& callback : callbacks) {
+        callback(addresses);
+    }
+}
+
+ResolverStats Resolver::GetStats() {
+    lock_guard<mutex> guard(_lock);
+
+    return ResolverStats{_hits, _misses, _cache.size()};
+}
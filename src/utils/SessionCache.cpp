@@ -0,0 +1,100 @@
+#include <ctime>
+#include <functional>
+#include <openssl/ssl.h>
+
+#include "utils/SessionCache.h"
+
+using namespace std;
+
+constexpr size_t SessionCache::NUMBER_OF_SHARDS;
+
+SessionCache::SessionCache(size_t maxEntries)
+    : _shards(), _maxEntriesPerShard(max<size_t>(1, (maxEntries + NUMBER_OF_SHARDS - 1) / NUMBER_OF_SHARDS)) {}
+
+SessionCache::Shard& SessionCache::GetShard(const string& id) {
+    return _shards[hash<string>()(id) % NUMBER_OF_SHARDS];
+}
+
+SSL_SESSION_OPTR SessionCache::Get(const string& id) {
+    DEF_SSL_SESSION(res, nullptr);
+    Shard& shard = GetShard(id);
+    unique_lock<mutex> l(shard.lock);
+
+    auto it = shard.index.find(id);
+    if (it == shard.index.end()) {
+        shard.misses++;
+        return res;
+    }
+
+    SSL_SESSION_PTR session = it->second->second.Get();
+
+    if (SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) < time(nullptr)) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        shard.misses++;
+        return res;
+    }
+
+    shard.hits++;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+    SSL_SESSION_up_ref(session);
+    res = session;
+
+    return res;
+}
+
+void SessionCache::Put(const string& id, SSL_SESSION_PTR session) {
+    Shard& shard = GetShard(id);
+
+    if (session == nullptr) {
+        return;
+    }
+
+    SSL_SESSION_up_ref(session);
+    DEF_SSL_SESSION(entry, session);
+
+    unique_lock<mutex> l(shard.lock);
+
+    auto it = shard.index.find(id);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(entry);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.emplace_front(id, std::move(entry));
+    shard.index.emplace(id, shard.lru.begin());
+
+    while (shard.lru.size() > _maxEntriesPerShard) {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+}
+
+void SessionCache::Remove(const string& id) {
+    Shard& shard = GetShard(id);
+    unique_lock<mutex> l(shard.lock);
+
+    auto it = shard.index.find(id);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+SessionCacheStats SessionCache::GetStats() {
+    SessionCacheStats stats{0, 0, 0, 0};
+
+    for (auto& shard : _shards) {
+        unique_lock<mutex> l(shard.lock);
+
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.lru.size();
+    }
+
+    return stats;
+}
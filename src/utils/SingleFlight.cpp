@@ -0,0 +1,35 @@
+#include "utils/SingleFlight.h"
+
+bool SingleFlight::Join(const std::string& key, const callback_t& callback) {
+    std::unique_lock<std::mutex> l(_lock);
+
+    auto it = _inFlight.find(key);
+    if (it == _inFlight.end()) {
+        _inFlight.emplace(key, std::vector<callback_t>());
+        return true;
+    }
+
+    it->second.push_back(callback);
+    return false;
+}
+
+void SingleFlight::Complete(const std::string& key, Outcome outcome) {
+    std::vector<callback_t> followers;
+
+    {
+        std::unique_lock<std::mutex> l(_lock);
+
+        auto it = _inFlight.find(key);
+        if (it == _inFlight.end()) {
+            return;
+        }
+
+        followers.swap(it->second);
+        _inFlight.erase(it);
+    }
+
+    // call the followers without holding the lock, they may join again
+    for (auto& follower : followers) {
+        follower(outcome);
+    }
+}
@@ -1,6 +1,9 @@
 #include "utils/ThreadPool.h"
 
-ThreadPool::ThreadPool(uint8_t numberOfThreads) : _running(false), _numberOfThreads(numberOfThreads) { Start(); }
+ThreadPool::ThreadPool(uint8_t numberOfThreads)
+    : _queueDepth(0), _running(false), _numberOfThreads(numberOfThreads) {
+    Start();
+}
 
 void ThreadPool::Start() {
     if (!_running) {
@@ -29,6 +32,7 @@ void ThreadPool::AddTask(const task_t& task) {
     {
         std::unique_lock<std::mutex> l(_qLock);
         _taskQ.push_back(task);
+        _queueDepth.store(_taskQ.size(), std::memory_order_relaxed);
     }
 
     _qCv.notify_all();
@@ -46,6 +50,7 @@ void ThreadPool::WorkerLoop() {
             if (!_taskQ.empty()) {
                 w = _taskQ.front();
                 _taskQ.pop_front();
+                _queueDepth.store(_taskQ.size(), std::memory_order_relaxed);
             }
         }
 
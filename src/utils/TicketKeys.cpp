@@ -0,0 +1,81 @@
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include "utils/Logger.h"
+#include "utils/TicketKeys.h"
+
+using namespace std;
+
+constexpr size_t TicketKeys::NAME_SIZE;
+
+// the current key and the previous one
+constexpr size_t NUMBER_OF_KEYS = 2;
+
+TicketKeys::TicketKeys(chrono::seconds rotation) : _rotation(rotation), _lock(), _keys() {}
+
+bool TicketKeys::Rotate() {
+    auto now = chrono::steady_clock::now();
+
+    if (!_keys.empty() && now - _keys.front().created < _rotation) {
+        return true;
+    }
+
+    Key key;
+
+    if (RAND_bytes(key.name, sizeof(key.name)) <= 0 || RAND_bytes(key.aesKey, sizeof(key.aesKey)) <= 0 ||
+        RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) <= 0) {
+        LOG_ERROR("Unable to generate a session ticket key");
+        return !_keys.empty();
+    }
+
+    key.created = now;
+    _keys.push_front(key);
+
+    if (_keys.size() > NUMBER_OF_KEYS) {
+        _keys.pop_back();
+    }
+
+    LOG_TRACE("Rotated the session ticket key");
+    return true;
+}
+
+int32_t TicketKeys::Setup(uint8_t* name, uint8_t* iv, EVP_CIPHER_CTX* cipher, HMAC_CTX* hmac, bool encrypt) {
+    lock_guard<mutex> guard(_lock);
+
+    if (!Rotate()) {
+        return -1;
+    }
+
+    if (encrypt) {
+        const Key& key = _keys.front();
+
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) <= 0 ||
+            EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) <= 0 ||
+            HMAC_Init_ex(hmac, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr) <= 0) {
+            return -1;
+        }
+
+        memcpy(name, key.name, NAME_SIZE);
+        return 1;
+    }
+
+    for (size_t i = 0; i < _keys.size(); i++) {
+        const Key& key = _keys[i];
+
+        if (memcmp(name, key.name, NAME_SIZE) != 0) {
+            continue;
+        }
+
+        if (HMAC_Init_ex(hmac, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr) <= 0 ||
+            EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) <= 0) {
+            return -1;
+        }
+
+        // a ticket of the previous key is replaced with one of the current key
+        return i == 0 ? 1 : 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// A minimal unit test harness.
+// TEST(Name) defines a test case which is registered before main() runs, EXPECT(condition) reports a failed
+// check and lets the test case go on, so a single run shows every failure.
+namespace test {
+
+struct TestCase {
+    const char* name;
+    std::function<void()> body;
+};
+
+std::vector<TestCase>& TestCases();
+
+// Number of failed checks since the program started
+size_t& Failures();
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) { TestCases().push_back(TestCase{name, body}); }
+};
+
+}; // namespace test
+
+#define TEST(name)                                                                                                   \
+    static void name();                                                                                              \
+    static test::Registrar name##Registrar(#name, name);                                                             \
+    static void name()
+
+#define EXPECT(condition)                                                                                            \
+    do {                                                                                                             \
+        if (!(condition)) {                                                                                          \
+            std::cerr << (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__) << ":" << __LINE__         \
+                      << ": EXPECT(" #condition ") failed" << std::endl;                                             \
+            test::Failures()++;                                                                                      \
+        }                                                                                                            \
+    } while (false)
@@ -0,0 +1,270 @@
+#include "Test.h"
+#include "http/HttpFramer.h"
+#include "http/HttpParser.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Splits a stream of messages the way a connection reads it: the head is parsed as it arrives, the framer
+// consumes the body and the bytes past the end of a message start the next one
+class StreamReader {
+  public:
+    StreamReader() : _parser(), _framer(), _pending(), _message(), _isBody(false), _messages() {}
+
+    // Read data, the next bytes of the stream, returns false if the stream can not be framed
+    bool Read(const string& data) {
+        _pending += data;
+
+        for (;;) {
+            if (!_isBody) {
+                HttpParser::Status status = _parser.Parse(_pending);
+
+                if (status != HttpParser::Status::DONE) {
+                    return status == HttpParser::Status::INCOMPLETE;
+                } else if (!_framer.Start(_parser, false)) {
+                    return false;
+                }
+
+                _message = _pending.substr(0, _parser.HeadSize());
+                _pending.erase(0, _parser.HeadSize());
+                _isBody = true;
+            }
+
+            size_t bytes = _framer.Consume(_pending.data(), _pending.size());
+
+            if (_framer.HasError()) {
+                return false;
+            }
+
+            _message += _pending.substr(0, bytes);
+            _pending.erase(0, bytes);
+
+            if (!_framer.IsComplete()) {
+                return true;
+            }
+
+            _messages.push_back(_message);
+            _parser.Reset();
+            _isBody = false;
+        }
+    }
+
+    inline const vector<string>& Messages() const { return _messages; }
+
+  private:
+    HttpParser _parser;
+    HttpFramer _framer;
+    string _pending;
+    string _message; // the current message, head and body bytes read so far
+    bool _isBody;
+    vector<string> _messages;
+};
+
+// Start framer with the head of message, returns false if the head or its framing is invalid
+static bool Start(HttpFramer& framer, HttpParser& parser, const string& message, bool isHeadRequest = false) {
+    parser.Reset();
+    return parser.Parse(message) == HttpParser::Status::DONE && framer.Start(parser, isHeadRequest);
+}
+
+// Frame the message and return the number of body bytes which belong to it, framer tells where it stopped
+static size_t Frame(HttpFramer& framer, const string& message, bool isHeadRequest = false) {
+    HttpParser parser;
+
+    if (!Start(framer, parser, message, isHeadRequest)) {
+        return string::npos;
+    }
+
+    return framer.Consume(message.data() + parser.HeadSize(), message.size() - parser.HeadSize());
+}
+
+TEST(FramesContentLength) {
+    HttpFramer framer;
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET") == 5);
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::LENGTH);
+    EXPECT(framer.IsComplete());
+    EXPECT(framer.IsKeepAlive());
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nhel") == 3);
+    EXPECT(!framer.IsComplete());
+    EXPECT(framer.Consume("loGET", 5) == 2);
+    EXPECT(framer.IsComplete());
+
+    EXPECT(Frame(framer, "GET / HTTP/1.1\r\n\r\nGET") == 0);
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::NONE);
+    EXPECT(framer.IsComplete());
+}
+
+TEST(RejectsInvalidContentLength) {
+    HttpFramer framer;
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello") == 5);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n") == string::npos);
+    EXPECT(framer.HasError());
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 5, 6\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: -5\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: +5\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 0x5\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 18446744073709551616\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length:\r\n\r\n") == string::npos);
+}
+
+TEST(TransferEncodingOverridesContentLength) {
+    HttpFramer framer;
+    string body = "5\r\nhello\r\n0\r\n\r\n";
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n" + body) ==
+           body.size());
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::CHUNKED);
+    EXPECT(framer.IsLengthOverridden());
+    EXPECT(framer.IsComplete());
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n" + body) ==
+           body.size());
+    EXPECT(framer.IsLengthOverridden());
+
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" + body) == body.size());
+    EXPECT(!framer.IsLengthOverridden());
+
+    // a request body which is not chunked last can not be framed
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n") == string::npos);
+    EXPECT(Frame(framer, "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nContent-Length: 3\r\n\r\n") ==
+           string::npos);
+
+    // a response is read until the connection closes
+    EXPECT(Frame(framer, "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\nContent-Length: 3\r\n\r\nabcdef") == 6);
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::CLOSE);
+    EXPECT(framer.IsLengthOverridden());
+    EXPECT(!framer.IsKeepAlive());
+}
+
+TEST(FramesChunks) {
+    HttpFramer framer;
+    string head = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    vector<string> bodies{"0\r\n\r\n",
+                          "5\r\nhello\r\nA\r\n0123456789\r\n0\r\n\r\n",
+                          "5;name\r\nhello\r\n0\r\n\r\n",
+                          "5 ; name = value ; quoted=\"a;b \\\"c\\\"\"\r\nhello\r\n0\r\n\r\n",
+                          "5\r\nhello\r\n0\r\nExpires: never\r\nX-Trailer: 1\r\n\r\n",
+                          "5\nhello\n0\n\n",
+                          "000005\r\nhello\r\n0\r\n\r\n"};
+
+    for (const auto& body : bodies) {
+        EXPECT(Frame(framer, head + body + "GET") == body.size());
+        EXPECT(framer.IsComplete());
+    }
+}
+
+TEST(RejectsInvalidChunks) {
+    HttpFramer framer;
+    string head = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    vector<string> bodies{"\r\n",
+                          "zz\r\n",
+                          "-5\r\n",
+                          "0x5\r\n",
+                          "5 junk\r\nhello\r\n0\r\n\r\n",
+                          "5;\r\nhello\r\n0\r\n\r\n",
+                          "5;name=\r\nhello\r\n0\r\n\r\n",
+                          "5;name=\"open\r\nhello\r\n0\r\n\r\n",
+                          "5;na\x01me\r\nhello\r\n0\r\n\r\n",
+                          "10000000000000000\r\n",
+                          "5\r\nhelloX\r\n0\r\n\r\n",
+                          "5\r\nhello\rX0\r\n\r\n",
+                          "5\r\nhello\r\r\n0\r\n\r\n",
+                          string(9000, '1')};
+
+    for (const auto& body : bodies) {
+        Frame(framer, head + body);
+        EXPECT(framer.HasError());
+    }
+}
+
+TEST(FramesResponsesWithoutBody) {
+    HttpFramer framer;
+
+    EXPECT(Frame(framer, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n") == 0);
+    EXPECT(framer.IsInterim());
+    EXPECT(framer.IsComplete());
+
+    EXPECT(Frame(framer, "HTTP/1.1 204 No Content\r\nContent-Length: 5\r\n\r\nHTTP/") == 0);
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::NONE);
+    EXPECT(framer.IsComplete());
+    EXPECT(!framer.IsInterim());
+
+    EXPECT(Frame(framer, "HTTP/1.1 304 Not Modified\r\nTransfer-Encoding: chunked\r\n\r\nHTTP/") == 0);
+    EXPECT(framer.IsComplete());
+
+    EXPECT(Frame(framer, "HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nHTTP/", true) == 0);
+    EXPECT(framer.IsComplete());
+    EXPECT(framer.IsKeepAlive());
+
+    EXPECT(Frame(framer, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhelloHTTP/") == 5);
+    EXPECT(framer.IsComplete());
+}
+
+TEST(FramesHeadRequests) {
+    HttpFramer framer;
+    HttpParser parser;
+
+    EXPECT(Start(framer, parser, "HEAD / HTTP/1.1\r\nHost: a\r\n\r\n"));
+    EXPECT(framer.IsHeadRequest());
+    EXPECT(framer.IsComplete());
+
+    EXPECT(Start(framer, parser, "GET / HTTP/1.1\r\nHost: a\r\n\r\n"));
+    EXPECT(!framer.IsHeadRequest());
+}
+
+TEST(FramesUntilCloseOrUpgrade) {
+    HttpFramer framer;
+
+    EXPECT(Frame(framer, "HTTP/1.1 200 OK\r\n\r\nhello") == 5);
+    EXPECT(framer.GetBodyType() == HttpFramer::BodyType::CLOSE);
+    EXPECT(!framer.IsComplete());
+    EXPECT(!framer.IsKeepAlive());
+
+    EXPECT(Frame(framer, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n\x81\x05hello") == 7);
+    EXPECT(framer.IsUpgrade());
+    EXPECT(!framer.IsInterim());
+    EXPECT(!framer.IsComplete());
+}
+
+TEST(FindsKeepAlive) {
+    HttpFramer framer;
+    HttpParser parser;
+
+    EXPECT(Start(framer, parser, "GET / HTTP/1.1\r\n\r\n") && framer.IsKeepAlive());
+    EXPECT(Start(framer, parser, "GET / HTTP/1.1\r\nConnection: Upgrade, close\r\n\r\n") && !framer.IsKeepAlive());
+    EXPECT(Start(framer, parser, "GET / HTTP/1.0\r\n\r\n") && !framer.IsKeepAlive());
+    EXPECT(Start(framer, parser, "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n") && framer.IsKeepAlive());
+}
+
+TEST(SplitsPipelinedMessages) {
+    vector<string> messages{"GET /1 HTTP/1.1\r\nHost: a\r\n\r\n",
+                            "POST /2 HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello",
+                            "POST /3 HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5;x=1\r\nhello\r\n0\r\nA: b\r\n\r\n",
+                            "POST /4 HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+                            "HEAD /5 HTTP/1.1\r\n\r\n"};
+    string stream;
+
+    for (const auto& message : messages) {
+        stream += message;
+    }
+
+    // every split of the stream in two reads, and a read per byte
+    for (size_t split = 0; split <= stream.size(); split++) {
+        StreamReader reader;
+
+        EXPECT(reader.Read(stream.substr(0, split)));
+        EXPECT(reader.Read(stream.substr(split)));
+        EXPECT(reader.Messages() == messages);
+    }
+
+    StreamReader reader;
+
+    for (char c : stream) {
+        EXPECT(reader.Read(string(1, c)));
+    }
+
+    EXPECT(reader.Messages() == messages);
+}
@@ -0,0 +1,97 @@
+#include "Test.h"
+#include "http/HttpHeadEditor.h"
+#include "http/HttpMessage.h"
+#include <string>
+
+using namespace std;
+
+static const string REQUEST = "POST / HTTP/1.1\r\n"
+                              "Host: www.example.com\r\n"
+                              "Connection: close\r\n"
+                              "Accept: */*\r\n"
+                              "connection: Upgrade\r\n"
+                              "Content-Length: 5\r\n"
+                              "\r\n"
+                              "hello";
+
+static string Edited(const HttpHeadEditor& edits) {
+    string out;
+
+    edits.WriteTo(out);
+    return out;
+}
+
+TEST(KeepsAnUnchangedMessage) {
+    HttpMessage message(REQUEST);
+    HttpHeadEditor edits(message);
+
+    EXPECT(edits.Empty());
+    EXPECT(edits.Segments().size() == 1);
+    EXPECT(Edited(edits) == REQUEST);
+
+    // a header which already has the value is not changed
+    edits.Set("Host", "www.example.com");
+    EXPECT(edits.Empty());
+}
+
+TEST(SetsHeaders) {
+    HttpMessage message(REQUEST);
+    HttpHeadEditor edits(message);
+
+    edits.Set("CONNECTION", "keep-alive");
+    EXPECT(!edits.Empty());
+    EXPECT(Edited(edits) == "POST / HTTP/1.1\r\n"
+                            "Host: www.example.com\r\n"
+                            "Connection: keep-alive\r\n"
+                            "Accept: */*\r\n"
+                            "Content-Length: 5\r\n"
+                            "\r\n"
+                            "hello");
+
+    // the unchanged lines are not copied
+    vector<StringView> segments = edits.Segments();
+    EXPECT(segments.size() == 4);
+    EXPECT(segments[0].data() == message.OriginalMessage().data());
+    EXPECT(segments[1] == "Connection: keep-alive\r\n");
+    EXPECT(segments[2] == "Accept: */*\r\n");
+    EXPECT(segments[2].data() > message.OriginalMessage().data());
+
+    edits.Set("Connection", "close");
+    EXPECT(Edited(edits).find("Connection: close\r\nAccept") != string::npos);
+}
+
+TEST(RemovesHeaders) {
+    HttpMessage message(REQUEST);
+    HttpHeadEditor edits(message);
+
+    edits.Remove("connection");
+    edits.Remove("Content-Length");
+    edits.Remove("X-Missing");
+    EXPECT(Edited(edits) == "POST / HTTP/1.1\r\n"
+                            "Host: www.example.com\r\n"
+                            "Accept: */*\r\n"
+                            "\r\n"
+                            "hello");
+
+    // a removed header is added again after all the others
+    edits.Set("Connection", "close");
+    EXPECT(Edited(edits) == "POST / HTTP/1.1\r\n"
+                            "Host: www.example.com\r\n"
+                            "Accept: */*\r\n"
+                            "Connection: close\r\n"
+                            "\r\n"
+                            "hello");
+}
+
+TEST(AppendsHeaders) {
+    HttpMessage message("HTTP/1.1 200 OK\r\nServer: test\r\n\r\n");
+    HttpHeadEditor edits(message);
+
+    edits.Append("Via", "1.1 proxy");
+    edits.Set("X-Test", "1");
+    edits.Set("x-test", "2");
+    EXPECT(Edited(edits) == "HTTP/1.1 200 OK\r\nServer: test\r\nVia: 1.1 proxy\r\nX-Test: 2\r\n\r\n");
+
+    edits.Remove("VIA");
+    EXPECT(Edited(edits) == "HTTP/1.1 200 OK\r\nServer: test\r\nX-Test: 2\r\n\r\n");
+}
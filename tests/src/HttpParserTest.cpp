@@ -0,0 +1,97 @@
+#include "Test.h"
+#include "http/HttpParser.h"
+#include <string>
+
+using namespace std;
+
+static const string REQUEST = "POST /upload?id=1 HTTP/1.1\r\n"
+                              "Host: www.example.com\r\n"
+                              "content-type: text/plain\r\n"
+                              "Content-Length: 5\r\n"
+                              "\r\n"
+                              "hello";
+
+static HttpParser::Status Parse(const string& message) {
+    HttpParser parser;
+    return parser.Parse(message);
+}
+
+TEST(ParsesRequestHead) {
+    HttpParser parser;
+
+    EXPECT(parser.Parse(REQUEST) == HttpParser::Status::DONE);
+    EXPECT(parser.IsRequest());
+    EXPECT(parser.HeadSize() == REQUEST.size() - 5);
+    EXPECT(parser.StartLine() == "POST /upload?id=1 HTTP/1.1\r\n");
+    EXPECT(parser.Method() == "POST");
+    EXPECT(parser.Path() == "/upload?id=1");
+    EXPECT(parser.Version() == "HTTP/1.1");
+    EXPECT(parser.HeadersCount() == 3);
+    EXPECT(parser.GetHeader(1).name == "content-type");
+    EXPECT(parser.GetHeader(1).value == "text/plain");
+    EXPECT(parser.GetHeader(1).line == "content-type: text/plain\r\n");
+    EXPECT(parser.FindHeader("Content-Type") == "text/plain");
+    EXPECT(parser.FindHeader("Cookie").empty());
+}
+
+TEST(ParsesResponseHead) {
+    HttpParser parser;
+    string response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+    EXPECT(parser.Parse(response) == HttpParser::Status::DONE);
+    EXPECT(!parser.IsRequest());
+    EXPECT(parser.Version() == "HTTP/1.1");
+    EXPECT(parser.StatusCode() == "404");
+    EXPECT(parser.StatusCodeValue() == 404);
+    EXPECT(parser.Reason() == "Not Found");
+}
+
+TEST(ResumesAcrossReads) {
+    HttpParser parser;
+    string buffer;
+
+    // one byte per read, the buffer grows (and moves) between the calls
+    for (size_t i = 0; i < REQUEST.size() - 5; i++) {
+        buffer += REQUEST[i];
+
+        HttpParser::Status status = parser.Parse(buffer);
+        EXPECT(status == (buffer.size() < REQUEST.size() - 5 ? HttpParser::Status::INCOMPLETE
+                                                               : HttpParser::Status::DONE));
+    }
+
+    EXPECT(parser.HeadSize() == buffer.size());
+    EXPECT(parser.Path() == "/upload?id=1");
+    EXPECT(parser.HeadersCount() == 3);
+    EXPECT(parser.FindHeader("content-length") == "5");
+
+    // the views follow a copy of the parsed head
+    string copy(buffer);
+    EXPECT(parser.Parse(copy) == HttpParser::Status::DONE);
+    EXPECT(parser.StartLine().data() == copy.data());
+}
+
+TEST(ResetStartsANewMessage) {
+    HttpParser parser;
+    string response = "HTTP/1.0 200 OK\r\n\r\n";
+
+    EXPECT(parser.Parse(REQUEST) == HttpParser::Status::DONE);
+    parser.Reset();
+    EXPECT(parser.Parse(response) == HttpParser::Status::DONE);
+    EXPECT(!parser.IsRequest());
+    EXPECT(parser.HeadersCount() == 0);
+}
+
+TEST(RejectsInvalidStatusCodes) {
+    EXPECT(Parse("HTTP/1.1 20 OK\r\n\r\n") == HttpParser::Status::ERROR);
+    EXPECT(Parse("HTTP/1.1 2000 OK\r\n\r\n") == HttpParser::Status::ERROR);
+    EXPECT(Parse("HTTP/1.1 2x0 OK\r\n\r\n") == HttpParser::Status::ERROR);
+    EXPECT(Parse("HTTP/1.1 -20 OK\r\n\r\n") == HttpParser::Status::ERROR);
+    EXPECT(Parse("HTTP/1.1 204\r\n\r\n") == HttpParser::Status::DONE);
+}
+
+TEST(RejectsControlCharacters) {
+    const char withNull[] = "GET / HTTP/1.1\r\nHost: a\0.com\r\n\r\n";
+
+    EXPECT(Parse("GET / HTTP/1.1\r\nHost: a\x01.com\r\n\r\n") == HttpParser::Status::ERROR);
+    EXPECT(Parse(string(withNull, sizeof(withNull) - 1)) == HttpParser::Status::ERROR);
+}
@@ -0,0 +1,35 @@
+#include "Test.h"
+
+using namespace std;
+
+namespace test {
+
+vector<TestCase>& TestCases() {
+    static vector<TestCase> testCases;
+    return testCases;
+}
+
+size_t& Failures() {
+    static size_t failures = 0;
+    return failures;
+}
+
+}; // namespace test
+
+// Run all the test cases, the exit status is not 0 if one of them failed
+int main() {
+    size_t failedCases = 0;
+
+    for (const auto& testCase : test::TestCases()) {
+        size_t failures = test::Failures();
+
+        testCase.body();
+
+        bool isPassed = test::Failures() == failures;
+        failedCases += isPassed ? 0 : 1;
+        cout << (isPassed ? "[ PASS ] " : "[ FAIL ] ") << testCase.name << endl;
+    }
+
+    cout << test::TestCases().size() - failedCases << "/" << test::TestCases().size() << " test cases passed" << endl;
+    return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "utils/AccessLog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <getopt.h>
+#include <string>
+
+using namespace std;
+
+// In the order of HttpMessage::HttpMethod
+static const char* const METHODS[] = {"NONE",   "GET",     "HEAD",    "POST",  "PUT",
+                                      "DELETE", "CONNECT", "OPTIONS", "TRACE", "PATCH"};
+
+// Which records are printed, an empty or zero value matches every record
+struct Filter {
+    string host;
+    uint16_t status = 0;
+    uint16_t statusGroup = 0; // the first digit of the status code, from "Nxx"
+    string method;
+    uint32_t minTime = 0; // microseconds
+    bool isIncompleteOnly = false;
+};
+
+static const char* MethodName(uint8_t method) {
+    return method < sizeof(METHODS) / sizeof(METHODS[0]) ? METHODS[method] : "UNKNOWN";
+}
+
+static bool Matches(const Filter& filter, const AccessRecord& record, StringView host) {
+    return (filter.host.empty() || host == filter.host) &&
+           (filter.status == 0 || record.statusCode == filter.status) &&
+           (filter.statusGroup == 0 || record.statusCode / 100 == filter.statusGroup) &&
+           (filter.method.empty() || filter.method == MethodName(record.method)) &&
+           record.totalTime >= filter.minTime && (!filter.isIncompleteOnly || (record.flags & ACCESS_COMPLETE) == 0);
+}
+
+static void Print(const AccessRecord& record, StringView host, StringView path) {
+    auto seconds = static_cast<time_t>(record.startTime / 1000000);
+    char time[32];
+    struct tm local;
+
+    localtime_r(&seconds, &local);
+    strftime(time, sizeof(time), "%FT%T", &local);
+
+    printf("%s.%06u conn %u/%u %s %.*s:%u%.*s %u req %u+%lu resp %u+%lu upstream %.3fms wait %.3fms transfer %.3fms "
+           "total %.3fms%s%s\n",
+           time, static_cast<uint32_t>(record.startTime % 1000000), record.connectionId, record.exchange,
+           MethodName(record.method), static_cast<int>(host.size()), host.data(), record.port,
+           static_cast<int>(path.size()), path.data(), record.statusCode, record.requestHeadSize,
+           static_cast<unsigned long>(record.requestBodySize), record.responseHeadSize,
+           static_cast<unsigned long>(record.responseBodySize), record.upstreamTime / 1000.0, record.waitTime / 1000.0,
+           record.transferTime / 1000.0, record.totalTime / 1000.0,
+           (record.flags & ACCESS_UPSTREAM_REUSED) ? " reused" : "",
+           (record.flags & ACCESS_COMPLETE) ? "" : " incomplete");
+}
+
+static void Usage() {
+    fprintf(stderr, "Usage: tls-proxy-logcat [--host <host>] [--status <code|Nxx>] [--method <method>] "
+                    "[--min-time <ms>] [--incomplete] <segment files...>\n");
+}
+
+int main(int argc, char* const argv[]) {
+    int res = 0;
+    int optionIndex = 0;
+    Filter filter;
+
+    static struct option longOptions[] = {
+        {"host", required_argument, nullptr, 0},   {"status", required_argument, nullptr, 0},
+        {"method", required_argument, nullptr, 0}, {"min-time", required_argument, nullptr, 0},
+        {"incomplete", no_argument, nullptr, 0},   {nullptr, 0, nullptr, 0}};
+
+    while ((res = getopt_long(argc, argv, "", longOptions, &optionIndex)) != -1) {
+        if (res != 0) {
+            Usage();
+            return 1;
+        }
+
+        switch (optionIndex) {
+        case 0:
+            filter.host = optarg;
+            break;
+        case 1:
+            if (strlen(optarg) == 3 && strcmp(optarg + 1, "xx") == 0) {
+                filter.statusGroup = optarg[0] - '0';
+            } else {
+                filter.status = stoul(optarg);
+            }
+            break;
+        case 2:
+            filter.method = optarg;
+            break;
+        case 3:
+            filter.minTime = static_cast<uint32_t>(stod(optarg) * 1000);
+            break;
+        case 4:
+            filter.isIncompleteOnly = true;
+            break;
+        }
+    }
+
+    if (optind >= argc) {
+        Usage();
+        return 1;
+    }
+
+    int exitCode = 0;
+
+    for (int i = optind; i < argc; i++) {
+        AccessLogReader reader(argv[i]);
+        AccessRecord record;
+
+        if (!reader.IsValid()) {
+            fprintf(stderr, "%s is not an access log segment\n", argv[i]);
+            exitCode = 1;
+            continue;
+        }
+
+        while (reader.Next(record)) {
+            StringView host = reader.String(record.hostId);
+
+            if (Matches(filter, record, host)) {
+                Print(record, host, reader.String(record.pathId));
+            }
+        }
+    }
+
+    return exitCode;
+}